@@ -0,0 +1,218 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef INCLUDE_CAN_BUS_LOAD_H_
+#define INCLUDE_CAN_BUS_LOAD_H_
+
+#include <map>
+#include <string>
+#include <cstdio>
+#include <stdint.h>
+
+
+/*
+ * Counts frames and bits on a CAN bus, per CANopen COB-ID class and interpreter command.
+ * Bits are computed exactly for standard (11 bit) data frames, including CRC and bit stuffing.
+ * CAN FD frames (more than 8 bytes) are estimated, in nominal bit times.
+ */
+class CanBusLoad {
+public:
+	struct counter_t
+	{
+		uint64_t num_frames = 0;
+		uint64_t num_bits = 0;
+	};
+
+	double data_bit_time = 1;			// CAN FD data phase bit time relative to nominal (with BRS)
+
+	void clear()
+	{
+		total = counter_t();
+		classes.clear();
+	}
+
+	void add(uint32_t id, int length, const uint8_t* data, bool is_brs = false)
+	{
+		const int num_bits = get_frame_bits(id, length, data, is_brs ? data_bit_time : 1);
+		counter_t& entry = classes[get_class(id, length, data)];
+		entry.num_frames++;
+		entry.num_bits += num_bits;
+		total.num_frames++;
+		total.num_bits += num_bits;
+	}
+
+	const counter_t& get_total() const {
+		return total;
+	}
+
+	const std::map<uint32_t, counter_t>& get_classes() const {
+		return classes;
+	}
+
+	/*
+	 * Returns number of bits on the bus for a standard data frame, including stuff bits and inter-frame space.
+	 * For CAN FD frames data_bit_time is the data phase bit time relative to nominal (1 = no bit rate switch).
+	 */
+	static int get_frame_bits(uint32_t id, int length, const uint8_t* data, double data_bit_time = 1)
+	{
+		if(length > 8) {
+			return get_fd_frame_bits(length, data_bit_time);
+		}
+		// SOF, ID, RTR, IDE, r0, DLC, DATA
+		uint8_t bits[19 + 64 + 15];
+		int num_bits = 0;
+		bits[num_bits++] = 0;
+		for(int i = 10; i >= 0; --i) {
+			bits[num_bits++] = (id >> i) & 1;
+		}
+		bits[num_bits++] = 0;
+		bits[num_bits++] = 0;
+		bits[num_bits++] = 0;
+		for(int i = 3; i >= 0; --i) {
+			bits[num_bits++] = (length >> i) & 1;
+		}
+		for(int k = 0; k < length && k < 8; ++k) {
+			for(int i = 7; i >= 0; --i) {
+				bits[num_bits++] = (data[k] >> i) & 1;
+			}
+		}
+
+		// CRC
+		uint16_t crc = 0;
+		for(int i = 0; i < num_bits; ++i)
+		{
+			const bool crc_next = bits[i] ^ ((crc >> 14) & 1);
+			crc = (crc << 1) & 0x7FFF;
+			if(crc_next) {
+				crc ^= 0x4599;
+			}
+		}
+		for(int i = 14; i >= 0; --i) {
+			bits[num_bits++] = (crc >> i) & 1;
+		}
+
+		// stuff bit after 5 equal bits (stuff bit counts for the next sequence)
+		int num_stuff = 0;
+		int run = 1;
+		uint8_t last = bits[0];
+		for(int i = 1; i < num_bits; ++i)
+		{
+			if(bits[i] == last) {
+				run++;
+			} else {
+				last = bits[i];
+				run = 1;
+			}
+			if(run == 5) {
+				num_stuff++;
+				last = !last;
+				run = 1;
+			}
+		}
+
+		// CRC delimiter, ACK, EOF, IFS
+		return num_bits + num_stuff + 1 + 2 + 7 + 3;
+	}
+
+	/*
+	 * Returns approximate number of nominal bit times for a CAN FD frame, assuming worst case stuffing.
+	 * Bits from ESI up to the CRC take data_bit_time each (ie. nominal / data bitrate with BRS).
+	 */
+	static int get_fd_frame_bits(int length, double data_bit_time = 1)
+	{
+		const int num_arb_bits = 17 + 4;					// SOF, ID, RRS, IDE, FDF, res, BRS + stuff bits
+		const int num_bits = 5 + 8 * length;				// ESI, DLC, DATA
+		const int num_crc = length > 16 ? 21 : 17;
+		const int num_fixed_stuff = (4 + num_crc) / 4 + 1;		// stuff count and CRC have fixed stuff bits
+		const int num_data_bits = num_bits + num_bits / 4 + 4 + num_crc + num_fixed_stuff;
+		return int(num_arb_bits + num_data_bits * data_bit_time + 0.5) + 1 + 2 + 7 + 3;
+	}
+
+	/*
+	 * Returns a class key for a frame: COB-ID function code, node id for NMT/SYNC, and command for interpreter frames.
+	 */
+	static uint32_t get_class(uint32_t id, int length, const uint8_t* data)
+	{
+		const uint32_t function = id & 0x780;
+		uint32_t key = function << 16;
+		if(function == 0x080 && id == 0x80) {
+			key |= 1;					// SYNC instead of EMCY
+		}
+		if((function == 0x280 || function == 0x300) && length >= 2) {
+			key |= (data[0] << 8) | data[1];
+		}
+		return key;
+	}
+
+	static std::string get_class_name(uint32_t key)
+	{
+		std::string name;
+		switch(key >> 16)
+		{
+			case 0x000: name = "NMT"; break;
+			case 0x080: name = (key & 1) ? "SYNC" : "EMCY"; break;
+			case 0x100: name = "TIME"; break;
+			case 0x180: name = "TPDO1"; break;
+			case 0x200: name = "RPDO1"; break;
+			case 0x280: name = "TPDO2"; break;
+			case 0x300: name = "RPDO2"; break;
+			case 0x380: name = "TPDO3"; break;
+			case 0x400: name = "RPDO3"; break;
+			case 0x480: name = "TPDO4"; break;
+			case 0x500: name = "RPDO4"; break;
+			case 0x580: name = "TSDO"; break;
+			case 0x600: name = "RSDO"; break;
+			case 0x700: name = "NMT_EC"; break;
+			default: {
+				char buf[16];
+				std::snprintf(buf, sizeof(buf), "0x%03X", key >> 16);
+				name = buf;
+			}
+		}
+		const char cmd_1 = (key >> 8) & 0xFF;
+		const char cmd_2 = key & 0xFF;
+		if(cmd_1 >= 'A' && cmd_1 <= 'Z' && cmd_2 >= 'A' && cmd_2 <= 'Z') {
+			name += std::string(" ") + cmd_1 + cmd_2;
+		}
+		return name;
+	}
+
+private:
+	counter_t total;
+	std::map<uint32_t, counter_t> classes;
+
+};
+
+
+#endif // INCLUDE_CAN_BUS_LOAD_H_
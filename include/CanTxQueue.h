@@ -0,0 +1,193 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef INCLUDE_CAN_TX_QUEUE_H_
+#define INCLUDE_CAN_TX_QUEUE_H_
+
+#include <array>
+#include <deque>
+#include <stdexcept>
+#include <stdint.h>
+
+
+/*
+ * Bounded transmit queue for CAN messages.
+ * Commands are kept in strict FIFO order, since motor command sequences depend on it (ie. configure, arm, begin).
+ * Periodic messages (setpoints, SYNC) are sent ahead of commands and coalesced,
+ * ie. a newer message with the same (non-zero) key replaces an older one in place.
+ * When full the oldest periodic message is dropped, otherwise the new message is rejected.
+ * SYNC / heartbeat and setpoints are deliberately one class, as are SDO and interpreter commands / queries,
+ * instead of four separate ones: splitting either pair would reorder msgs the drives rely on.
+ */
+template<typename T>
+class CanTxQueue {
+public:
+	enum priority_e
+	{
+		PRIO_COMMAND,			// commands, configuration and queries (strict FIFO)
+		PRIO_PERIODIC,			// periodic setpoints, SYNC and heartbeat (coalesced)
+		NUM_PRIO
+	};
+
+	CanTxQueue(size_t capacity_)
+		:	capacity(capacity_)
+	{
+		if(capacity_ < 1) {
+			throw std::logic_error("capacity < 1");
+		}
+	}
+
+	void clear()
+	{
+		for(auto& queue : queues) {
+			queue.clear();
+		}
+		count = 0;
+	}
+
+	/*
+	 * Removes all messages of given priority.
+	 *
+	 * @return number of messages removed.
+	 */
+	size_t clear(priority_e priority)
+	{
+		auto& queue = queues.at(priority);
+		const size_t num_removed = queue.size();
+		queue.clear();
+		count -= num_removed;
+		return num_removed;
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	/*
+	 * Number of messages dropped since construction.
+	 */
+	uint64_t get_num_dropped() const {
+		return num_dropped;
+	}
+
+	/*
+	 * Number of messages coalesced since construction.
+	 */
+	uint64_t get_num_coalesced() const {
+		return num_coalesced;
+	}
+
+	/*
+	 * Adds a message, key = 0 disables coalescing (only used for PRIO_PERIODIC).
+	 *
+	 * @return false if message was dropped.
+	 */
+	bool push(const T& msg, priority_e priority, uint64_t key = 0)
+	{
+		auto& queue = queues.at(priority);
+		if(priority == PRIO_PERIODIC && key != 0)
+		{
+			for(auto& entry : queue)
+			{
+				if(entry.key == key) {
+					entry.msg = msg;
+					num_coalesced++;
+					return true;
+				}
+			}
+		}
+		if(count >= capacity)
+		{
+			// never drop from the middle of a command sequence, only stale periodic messages
+			num_dropped++;
+			auto& periodic = queues[PRIO_PERIODIC];
+			if(periodic.empty()) {
+				return false;
+			}
+			periodic.pop_front();
+			count--;
+		}
+		entry_t entry;
+		entry.msg = msg;
+		entry.key = key;
+		queue.push_back(entry);
+		count++;
+		return true;
+	}
+
+	/*
+	 * Returns oldest message of highest priority. Queue must not be empty.
+	 */
+	const T& front() const
+	{
+		for(int i = NUM_PRIO - 1; i >= 0; --i) {
+			if(!queues[i].empty()) {
+				return queues[i].front().msg;
+			}
+		}
+		throw std::logic_error("queue empty");
+	}
+
+	void pop()
+	{
+		for(int i = NUM_PRIO - 1; i >= 0; --i) {
+			if(!queues[i].empty()) {
+				queues[i].pop_front();
+				count--;
+				return;
+			}
+		}
+	}
+
+private:
+	struct entry_t
+	{
+		T msg;
+		uint64_t key = 0;
+	};
+
+	std::array<std::deque<entry_t>, NUM_PRIO> queues;
+	size_t capacity = 0;
+	size_t count = 0;
+	uint64_t num_dropped = 0;
+	uint64_t num_coalesced = 0;
+
+};
+
+
+#endif // INCLUDE_CAN_TX_QUEUE_H_
@@ -54,7 +54,14 @@ public:
 	double small_vel_threshold = 0.05;			// [m/s]
 	double steer_hysteresis = 0.5;				// [rad]
 	double steer_hysteresis_dynamic = 0.1;			// [rad]
+	double steer_align_time = 0.1;				// max time to reach steering angle while driving at full speed [s]
 
+	std::vector<double> max_wheel_vel;			// drive velocity limit per wheel, zero = unlimited [m/s]
+	std::vector<double> max_steer_vel;			// steering velocity limit per wheel, zero = unlimited [rad/s]
+
+	double vel_scale = 1;					// scale factor applied to last command to stay within limits (1 = not limited)
+
+	std::vector<bool> is_enabled;				// disabled wheels are held at their current angle with zero velocity
 	std::vector<bool> is_driving;
 	std::vector<bool> is_fast;
 	std::vector<bool> is_alternate;
@@ -63,10 +70,13 @@ public:
 	OmniKinematics(int num_wheels_)
 		:	num_wheels(num_wheels_)
 	{
+		is_enabled.resize(num_wheels_, true);
 		is_driving.resize(num_wheels_);
 		is_fast.resize(num_wheels_);
 		is_alternate.resize(num_wheels_);
 		last_stop_angle.resize(num_wheels_);
+		max_wheel_vel.resize(num_wheels_);
+		max_steer_vel.resize(num_wheels_);
 	}
 
 	// Sets initial steering angles to home angle
@@ -84,6 +94,10 @@ public:
 	* Computes desired wheel steering angles and velocities based on commanded
 	* platform velocity and yawrate.
 	*
+	* If any wheel would exceed its drive or steering limit, all wheel velocities are scaled
+	* by the same factor, which keeps the commanded path (ie. the instantaneous center of rotation).
+	* The factor is stored in vel_scale.
+	*
 	* @return Vector of OmniWheels with wheel_angle and wheel_vel set to desired values.
 	*/
 	std::vector<OmniWheel> compute(const std::vector<OmniWheel>& wheels, double move_vel_x, double move_vel_y, double move_yawrate)
@@ -93,9 +107,28 @@ public:
 		}
 		std::vector<OmniWheel> result;
 
+		vel_scale = 1;
+
 		for(int i = 0; i < num_wheels; ++i)
 		{
 			const OmniWheel& wheel = wheels[i];
+
+			// hold disabled wheels
+			if(!is_enabled[i])
+			{
+				OmniWheel new_wheel = wheel;
+				new_wheel.set_wheel_angle(wheel.wheel_angle - M_PI);
+				new_wheel.wheel_vel = 0;
+				result.push_back(new_wheel);
+
+				is_driving[i] = false;
+				last_stop_angle[i] = wheel.wheel_angle;
+				if(switching_wheel == i) {
+					switching_wheel = -1;
+				}
+				continue;
+			}
+
 			const double wheel_pos_radius = wheel.get_wheel_pos_radius();				// wheel position in polar coords [m]
 			const double wheel_pos_angle = wheel.get_wheel_pos_angle();					// wheel position in polar coords [rad]
 			const double tangential = wheel_pos_radius * move_yawrate;					// tangential velocity
@@ -153,12 +186,34 @@ public:
 				}
 			}
 
+			// check drive velocity limit
+			if(max_wheel_vel[i] > 0 && fabs(new_wheel_vel) > max_wheel_vel[i])
+			{
+				vel_scale = fmin(vel_scale, max_wheel_vel[i] / fabs(new_wheel_vel));
+			}
+
+			// check if steering can reach new angle in time, otherwise slow down
+			if(is_driving[i] && max_steer_vel[i] > 0)
+			{
+				const double steer_delta = fabs(angles::shortest_angular_distance(wheel.wheel_angle, new_wheel_angle));
+				const double steer_time = steer_delta / max_steer_vel[i];
+
+				if(steer_time > steer_align_time) {
+					vel_scale = fmin(vel_scale, steer_align_time / steer_time);
+				}
+			}
+
 			// store new values
 			OmniWheel new_wheel = wheel;
 			new_wheel.set_wheel_angle(new_wheel_angle - M_PI);
 			new_wheel.wheel_vel = -1 * new_wheel_vel;
 			result.push_back(new_wheel);
 		}
+
+		// apply common scale factor (steering angles are not affected)
+		for(auto& wheel : result) {
+			wheel.wheel_vel *= vel_scale;
+		}
 		return result;
 	}
 
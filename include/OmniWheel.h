@@ -55,6 +55,7 @@ public:
 
 	double wheel_angle = 0;				// current wheel angle relative to base_link [rad]
 	double wheel_vel = 0;				// current wheel velocity between ground and wheel_link [m/s]
+	double steer_vel = 0;				// current steering velocity relative to base_link [rad/s]
 
 	std::string drive_joint_name;
 	std::string steer_joint_name;
@@ -0,0 +1,160 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef INCLUDE_POSE_HISTORY_H_
+#define INCLUDE_POSE_HISTORY_H_
+
+#include <angles/angles.h>
+
+#include <vector>
+#include <stdexcept>
+#include <math.h>
+
+
+/*
+ * Fixed capacity ring buffer of platform poses and velocities, sorted by time.
+ * Allows to query interpolated poses at arbitrary times within the buffered range.
+ */
+class PoseHistory {
+public:
+	struct sample_t
+	{
+		double time = 0;			// [s]
+		double x = 0;				// [m]
+		double y = 0;				// [m]
+		double yaw = 0;				// [rad]
+		double vel_x = 0;			// [m/s]
+		double vel_y = 0;			// [m/s]
+		double yawrate = 0;			// [rad/s]
+	};
+
+	PoseHistory(size_t capacity_)
+		:	samples(capacity_)
+	{
+		if(capacity_ < 2) {
+			throw std::logic_error("capacity < 2");
+		}
+	}
+
+	void clear()
+	{
+		first = 0;
+		count = 0;
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	/*
+	 * Adds a new sample, overwriting the oldest one if full.
+	 * Samples have to be added in increasing time order, in case time jumps back the history is cleared.
+	 */
+	void add(const sample_t& sample)
+	{
+		if(count > 0 && sample.time <= at(count - 1).time)
+		{
+			if(sample.time == at(count - 1).time) {
+				return;			// ignore duplicate
+			}
+			clear();
+		}
+		if(count < samples.size()) {
+			samples[(first + count) % samples.size()] = sample;
+			count++;
+		} else {
+			samples[first] = sample;
+			first = (first + 1) % samples.size();
+		}
+	}
+
+	/*
+	 * Computes interpolated sample at given time, using binary search. [O(log n)]
+	 *
+	 * @return false if time is outside of buffered range.
+	 */
+	bool get_sample(double time, sample_t& result) const
+	{
+		if(count == 0 || time < at(0).time || time > at(count - 1).time) {
+			return false;
+		}
+
+		// find first sample with sample.time >= time
+		size_t begin = 0;
+		size_t end = count - 1;
+		while(begin < end)
+		{
+			const size_t mid = (begin + end) / 2;
+			if(at(mid).time < time) {
+				begin = mid + 1;
+			} else {
+				end = mid;
+			}
+		}
+
+		const sample_t& B = at(begin);
+		if(begin == 0 || B.time == time) {
+			result = B;
+			return true;
+		}
+		const sample_t& A = at(begin - 1);
+		const double alpha = (time - A.time) / (B.time - A.time);
+
+		result.time = time;
+		result.x = A.x + alpha * (B.x - A.x);
+		result.y = A.y + alpha * (B.y - A.y);
+		result.yaw = A.yaw + alpha * angles::shortest_angular_distance(A.yaw, B.yaw);
+		result.vel_x = A.vel_x + alpha * (B.vel_x - A.vel_x);
+		result.vel_y = A.vel_y + alpha * (B.vel_y - A.vel_y);
+		result.yawrate = A.yawrate + alpha * (B.yawrate - A.yawrate);
+		return true;
+	}
+
+private:
+	/*
+	 * Returns i-th sample in time order.
+	 */
+	const sample_t& at(size_t i) const {
+		return samples[(first + i) % samples.size()];
+	}
+
+private:
+	std::vector<sample_t> samples;
+	size_t first = 0;			// index of oldest sample
+	size_t count = 0;			// number of valid samples
+
+};
+
+
+#endif // INCLUDE_POSE_HISTORY_H_
@@ -0,0 +1,127 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef INCLUDE_SEQ_LOCK_H_
+#define INCLUDE_SEQ_LOCK_H_
+
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <stdint.h>
+
+
+/*
+ * Sequence lock for small trivially copyable data, ie. measured values.
+ * Readers never block writers, they retry in case of a concurrent write instead.
+ * Writers are serialized by spinning on the sequence, so should only hold it for a short copy.
+ */
+template<typename T>
+class SeqLock {
+public:
+	SeqLock() {}
+
+	SeqLock(const T& value)
+		:	data(value)
+	{
+	}
+
+	SeqLock(const SeqLock& other)
+		:	data(other.load())
+	{
+	}
+
+	SeqLock& operator=(const SeqLock& other)
+	{
+		store(other.load());
+		return *this;
+	}
+
+	/*
+	 * Returns a consistent copy.
+	 */
+	T load() const
+	{
+		while(true)
+		{
+			const uint32_t seq_0 = seq.load(std::memory_order_acquire);
+			if(seq_0 & 1) {
+				std::this_thread::yield();		// write in progress
+				continue;
+			}
+			T copy;
+			::memcpy(&copy, &data, sizeof(T));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(seq.load(std::memory_order_relaxed) == seq_0) {
+				return copy;
+			}
+		}
+	}
+
+	void store(const T& value)
+	{
+		modify([&value](T& data_) { data_ = value; });
+	}
+
+	/*
+	 * Calls func(T&) to modify the data in place.
+	 */
+	template<typename F>
+	void modify(F func)
+	{
+		uint32_t seq_0 = seq.load(std::memory_order_relaxed);
+		while((seq_0 & 1) || !seq.compare_exchange_weak(seq_0, seq_0 + 1, std::memory_order_acquire))
+		{
+			seq_0 = seq.load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+
+		struct guard_t {
+			std::atomic<uint32_t>& seq;
+			const uint32_t value;
+			~guard_t() {
+				seq.store(value, std::memory_order_release);		// also in case func() throws
+			}
+		} guard {seq, seq_0 + 2};
+
+		func(data);
+	}
+
+private:
+	std::atomic<uint32_t> seq {0};			// odd while a write is in progress
+	T data = T();
+
+};
+
+
+#endif // INCLUDE_SEQ_LOCK_H_
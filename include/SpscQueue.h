@@ -0,0 +1,137 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef INCLUDE_SPSC_QUEUE_H_
+#define INCLUDE_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+#include <stdint.h>
+
+
+/*
+ * Bounded lock-free queue for a single producer and a single consumer thread.
+ * All slots are allocated up front, copying into a slot re-uses its memory (ie. vector capacity).
+ * When full new elements are dropped, the consumer is never blocked by the producer and vice versa.
+ */
+template<typename T>
+class SpscQueue {
+public:
+	SpscQueue(size_t capacity_, const T& init = T())
+		:	slots(capacity_ + 1, init)
+	{
+		if(capacity_ < 1) {
+			throw std::logic_error("capacity < 1");
+		}
+	}
+
+	size_t capacity() const {
+		return slots.size() - 1;
+	}
+
+	/*
+	 * Approximate size, exact only if called by producer or consumer while the other is idle.
+	 */
+	size_t size() const {
+		const size_t head_ = head.load(std::memory_order_acquire);
+		const size_t tail_ = tail.load(std::memory_order_acquire);
+		return tail_ >= head_ ? tail_ - head_ : tail_ + slots.size() - head_;
+	}
+
+	bool empty() const {
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+	/*
+	 * Number of elements dropped since construction.
+	 */
+	uint64_t get_num_dropped() const {
+		return num_dropped.load(std::memory_order_relaxed);
+	}
+
+	/*
+	 * Adds an element, producer only.
+	 *
+	 * @return false if queue was full and element was dropped.
+	 */
+	bool push(const T& value)
+	{
+		const size_t tail_ = tail.load(std::memory_order_relaxed);
+		const size_t next = increment(tail_);
+		if(next == head.load(std::memory_order_acquire)) {
+			num_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		slots[tail_] = value;
+		tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * Removes oldest element, consumer only.
+	 *
+	 * @return false if queue was empty.
+	 */
+	bool pop(T& value)
+	{
+		const size_t head_ = head.load(std::memory_order_relaxed);
+		if(head_ == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		value = slots[head_];
+		head.store(increment(head_), std::memory_order_release);
+		return true;
+	}
+
+private:
+	size_t increment(size_t index) const {
+		return index + 1 < slots.size() ? index + 1 : 0;
+	}
+
+private:
+	std::vector<T> slots;
+
+	// padding instead of alignas(64), which operator new does not honor before C++17
+	char pad_0[64];
+	std::atomic<size_t> head {0};			// next element to pop, written by consumer
+	char pad_1[64];
+	std::atomic<size_t> tail {0};			// next slot to push, written by producer
+	std::atomic<uint64_t> num_dropped {0};	// written by producer
+	char pad_2[64];
+
+};
+
+
+#endif // INCLUDE_SPSC_QUEUE_H_
@@ -0,0 +1,92 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef INCLUDE_STEADY_CLOCK_H_
+#define INCLUDE_STEADY_CLOCK_H_
+
+#include <chrono>
+
+
+typedef std::chrono::steady_clock::time_point steady_time_t;
+
+/*
+ * Monotonic time, used for all timeouts since it does not jump with use_sim_time or system clock steps.
+ */
+inline steady_time_t get_steady_time()
+{
+	return std::chrono::steady_clock::now();
+}
+
+/*
+ * Returns given duration in seconds.
+ */
+inline double to_seconds(std::chrono::steady_clock::duration delta)
+{
+	return std::chrono::duration<double>(delta).count();
+}
+
+/*
+ * Converts steady time to another clock (ie. ROS time) for message stamps,
+ * based on a snapshot of both clocks taken once per cycle.
+ */
+class SteadyClockMap {
+public:
+	void update(steady_time_t steady_time, double time)
+	{
+		m_steady_time = steady_time;
+		m_time = time;
+	}
+
+	double convert(steady_time_t steady_time) const
+	{
+		return m_time + to_seconds(steady_time - m_steady_time);
+	}
+
+	/*
+	 * Converts a time of the other clock (ie. a message stamp) to steady time.
+	 */
+	steady_time_t to_steady(double time) const
+	{
+		return m_steady_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double>(time - m_time));
+	}
+
+private:
+	steady_time_t m_steady_time;
+	double m_time = 0;
+
+};
+
+
+#endif // INCLUDE_STEADY_CLOCK_H_
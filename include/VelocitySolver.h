@@ -39,6 +39,7 @@
 
 #include <neo_common/MatrixX.h>
 
+#include <vector>
 #include <math.h>
 #include <stdexcept>
 
@@ -56,12 +57,27 @@ public:
 	double move_vel_y = 0;			// solution [m/s]
 	double move_yawrate = 0;		// solution [rad/s]
 
+	std::vector<bool> is_enabled;	// disabled wheels are ignored
+
 	VelocitySolver(int num_wheels_)
 		:	num_wheels(num_wheels_),
 			M(num_wheels_ * 2)
 	{
 		R.resize(M, 1);
 		J.resize(M, 3);
+		is_enabled.resize(num_wheels_, true);
+	}
+
+	/*
+	 * Returns number of enabled wheels, at least two are needed to solve.
+	 */
+	int get_num_enabled() const
+	{
+		int count = 0;
+		for(int i = 0; i < num_wheels; ++i) {
+			count += is_enabled[i] ? 1 : 0;
+		}
+		return count;
 	}
 
 	void solve(const std::vector<OmniWheel>& wheels)
@@ -69,6 +85,9 @@ public:
 		if(wheels.size() != num_wheels) {
 			throw std::logic_error("wheels.size() != num_wheels");
 		}
+		if(get_num_enabled() < 2) {
+			throw std::logic_error("less than two wheels enabled");
+		}
 
 		// make two iterations to get final R_norm
 		for(int iter = 0; iter < 2; ++iter)
@@ -77,13 +96,21 @@ public:
 
 			for(int i = 0; i < num_wheels; ++i)
 			{
+				if(!is_enabled[i])
+				{
+					R[i * 2 + 0] = 0;		// no contribution to solution
+					R[i * 2 + 1] = 0;
+					continue;
+				}
 				const double wheel_pos_radius = wheels[i].get_wheel_pos_radius();	// wheel position in polar coords [m]
 				const double wheel_pos_angle = wheels[i].get_wheel_pos_angle();		// wheel position in polar coords [rad]
 				const double wheel_angle = wheels[i].wheel_angle;
 				const double wheel_vel = wheels[i].wheel_vel;
+				const double steer_vel = wheels[i].steer_vel;
+				const double lever_arm = wheels[i].lever_arm;
 
-				R[i * 2 + 0] = move_vel_x-wheel_vel*cos(wheel_angle)-wheel_pos_radius*sin(wheel_pos_angle)*move_yawrate;
-				R[i * 2 + 1] = -wheel_vel*sin(wheel_angle)+wheel_pos_radius*cos(wheel_pos_angle)*move_yawrate+move_vel_y;
+				R[i * 2 + 0] = move_vel_x-wheel_vel*cos(wheel_angle)-wheel_pos_radius*sin(wheel_pos_angle)*move_yawrate-lever_arm*steer_vel*cos(wheel_angle);
+				R[i * 2 + 1] = -wheel_vel*sin(wheel_angle)+wheel_pos_radius*cos(wheel_pos_angle)*move_yawrate+move_vel_y-lever_arm*steer_vel*sin(wheel_angle);
 
 				J(i * 2 + 0, 0) = 1;
 				J(i * 2 + 1, 1) = 1;
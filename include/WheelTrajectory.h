@@ -0,0 +1,146 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef INCLUDE_WHEEL_TRAJECTORY_H_
+#define INCLUDE_WHEEL_TRAJECTORY_H_
+
+#include <angles/angles.h>
+
+#include <vector>
+#include <stdexcept>
+
+
+/*
+ * Buffered multi-point trajectory of wheel velocities and steering angles.
+ * Sampled at every control cycle by linear interpolation, holding the first / last point outside of the horizon.
+ */
+class WheelTrajectory {
+public:
+	struct point_t
+	{
+		double time = 0;					// [s]
+		std::vector<double> wheel_vel;		// [rad/s]
+		std::vector<double> steer_pos;		// [rad]
+	};
+
+	void clear()
+	{
+		points.clear();
+	}
+
+	bool empty() const {
+		return points.empty();
+	}
+
+	size_t size() const {
+		return points.size();
+	}
+
+	/*
+	 * Returns time of the last point, ie. the end of the horizon.
+	 */
+	double get_end_time() const {
+		return points.empty() ? 0 : points.back().time;
+	}
+
+	/*
+	 * Replaces the current trajectory. Points have to be strictly increasing in time.
+	 */
+	void set(const std::vector<point_t>& points_)
+	{
+		for(size_t i = 0; i < points_.size(); ++i)
+		{
+			if(i > 0 && points_[i].time <= points_[i - 1].time) {
+				throw std::logic_error("trajectory points not increasing in time");
+			}
+			if(points_[i].wheel_vel.size() != points_[0].wheel_vel.size()
+				|| points_[i].steer_pos.size() != points_[0].steer_pos.size())
+			{
+				throw std::logic_error("trajectory point size mismatch");
+			}
+		}
+		points = points_;
+	}
+
+	/*
+	 * Computes interpolated wheel velocities and steering angles at given time.
+	 * Steering angles are interpolated along the shortest angular distance.
+	 * Output vectors need to have the proper size already.
+	 *
+	 * @return false if trajectory is empty.
+	 */
+	bool sample(double time, std::vector<double>& wheel_vel, std::vector<double>& steer_pos) const
+	{
+		if(points.empty()) {
+			return false;
+		}
+
+		// find first point with point.time > time
+		size_t k = 0;
+		while(k < points.size() && points[k].time <= time) {
+			k++;
+		}
+
+		if(k == 0 || k == points.size())
+		{
+			const point_t& P = points[k == 0 ? 0 : k - 1];
+			for(size_t i = 0; i < wheel_vel.size() && i < P.wheel_vel.size(); ++i) {
+				wheel_vel[i] = P.wheel_vel[i];
+			}
+			for(size_t i = 0; i < steer_pos.size() && i < P.steer_pos.size(); ++i) {
+				steer_pos[i] = P.steer_pos[i];
+			}
+			return true;
+		}
+
+		const point_t& A = points[k - 1];
+		const point_t& B = points[k];
+		const double alpha = (time - A.time) / (B.time - A.time);
+
+		for(size_t i = 0; i < wheel_vel.size() && i < A.wheel_vel.size(); ++i) {
+			wheel_vel[i] = A.wheel_vel[i] + alpha * (B.wheel_vel[i] - A.wheel_vel[i]);
+		}
+		for(size_t i = 0; i < steer_pos.size() && i < A.steer_pos.size(); ++i) {
+			steer_pos[i] = A.steer_pos[i] + alpha * angles::shortest_angular_distance(A.steer_pos[i], B.steer_pos[i]);
+		}
+		return true;
+	}
+
+private:
+	std::vector<point_t> points;
+
+};
+
+
+#endif // INCLUDE_WHEEL_TRAJECTORY_H_
@@ -34,23 +34,54 @@
 
 #include "../include/OmniKinematics.h"
 #include "../include/VelocitySolver.h"
+#include "../include/PoseHistory.h"
+#include "../include/SteadyClock.h"
 
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <tf/transform_broadcaster.h>
+#include <tf/tfMessage.h>
 #include <nav_msgs/Odometry.h>
 #include <neo_srvs/LockPlatform.h>
 #include <neo_srvs/UnlockPlatform.h>
 #include <neo_srvs/ResetOmniWheels.h>
+#include <neo_kinematics_omnidrive/GetPoseHistory.h>
 #include <geometry_msgs/Twist.h>
+#include <geometry_msgs/TwistStamped.h>
 #include <sensor_msgs/JointState.h>
 #include <trajectory_msgs/JointTrajectory.h>
 #include <sensor_msgs/Joy.h>
+#include <std_msgs/Float64.h>
+#include <dynamic_reconfigure/server.h>
+#include <neo_kinematics_omnidrive/OmniDriveConfig.h>
 
 #include <mutex>
+#include <memory>
 
 
 class NeoOmniDriveNode {
 public:
+	/*
+	 * Parameters which can be changed at runtime via dynamic_reconfigure.
+	 * Never modified once published, see m_params.
+	 */
+	struct kinematics_params_t
+	{
+		double zero_vel_threshold = 0;			// [m/s]
+		double small_vel_threshold = 0;			// [m/s]
+		double steer_hysteresis = 0;			// [rad]
+		double steer_hysteresis_dynamic = 0;	// [rad]
+		double steer_align_time = 0;			// [s]
+		double max_prediction_time = 0;			// [s]
+		double latency_low_pass = 0;
+		double min_accel_dt = 0;				// [s]
+		double accel_low_pass = 0;
+		double max_accel = 0;					// [m/s^2]
+		double max_yaw_accel = 0;				// [rad/s^2]
+		double max_vel = 0;						// [m/s]
+		double max_yaw_vel = 0;					// [rad/s]
+	};
+
 	NeoOmniDriveNode()
 	{
 		m_node_handle.param("broadcast_tf", m_broadcast_tf, true);
@@ -65,6 +96,12 @@ public:
 			throw std::logic_error("missing wheel_lever_arm param");
 		}
 		m_node_handle.param("cmd_timeout", m_cmd_timeout, 0.2);
+		m_node_handle.param("cmd_vel_stamped", m_cmd_vel_stamped, false);
+		m_node_handle.param("cmd_prediction", m_cmd_prediction, false);
+		m_node_handle.param("travel_odometry", m_travel_odometry, false);
+		m_node_handle.param("pose_history_size", m_pose_history_size, 200);
+		m_node_handle.param("idle_delay", m_idle_delay, 5.);
+		m_node_handle.param("idle_rate", m_idle_rate, 10.);
 		m_node_handle.param("homeing_button", m_homeing_button, 0);
 		m_node_handle.param("steer_reset_button", m_steer_reset_button, 1);
 
@@ -95,40 +132,116 @@ public:
 			m_wheels[i].home_angle = M_PI * m_wheels[i].home_angle / 180.;
 			m_wheels[i].set_wheel_angle(0);
 		}
+		m_odom_wheels = m_wheels;
+		m_drive_pos.resize(m_num_wheels);
+		m_last_drive_pos.resize(m_num_wheels);
+		m_last_wheel_angle.resize(m_num_wheels);
+		m_has_last_pos.resize(m_num_wheels);
+
+		// keep track of subscribers, to skip building messages nobody listens to
+		const ros::SubscriberStatusCallback subscriber_callback = boost::bind(&NeoOmniDriveNode::subscriber_callback, this, _1);
+
+		m_pub_odometry = m_node_handle.advertise<nav_msgs::Odometry>("/odom", 1, subscriber_callback, subscriber_callback);
+		m_pub_joint_trajectory = m_node_handle.advertise<trajectory_msgs::JointTrajectory>("/drives/joint_trajectory", 1, subscriber_callback, subscriber_callback);
+		m_pub_vel_scale = m_node_handle.advertise<std_msgs::Float64>("vel_scale", 1, subscriber_callback, subscriber_callback);
+		if(m_broadcast_tf) {
+			m_pub_tf = m_node_handle.advertise<tf::tfMessage>("/tf", 100, subscriber_callback, subscriber_callback);
+		}
 
-		m_pub_odometry = m_node_handle.advertise<nav_msgs::Odometry>("/odom", 1);
-		m_pub_joint_trajectory = m_node_handle.advertise<trajectory_msgs::JointTrajectory>("/drives/joint_trajectory", 1);
-
-		m_sub_cmd_vel = m_node_handle.subscribe("/cmd_vel", 3, &NeoOmniDriveNode::cmd_vel_callback, this);
+		if(m_cmd_vel_stamped) {
+			m_sub_cmd_vel = m_node_handle.subscribe("/cmd_vel_stamped", 3, &NeoOmniDriveNode::cmd_vel_stamped_callback, this);
+		} else {
+			m_sub_cmd_vel = m_node_handle.subscribe("/cmd_vel", 3, &NeoOmniDriveNode::cmd_vel_callback, this);
+		}
+		if(m_cmd_prediction) {
+			m_sub_cmd_latency = m_node_handle.subscribe("/drives/cmd_latency", 10, &NeoOmniDriveNode::cmd_latency_callback, this);
+		}
 		m_sub_joint_state = m_node_handle.subscribe("/drives/joint_states", 10, &NeoOmniDriveNode::joint_state_callback, this);
 		m_sub_joy = m_node_handle.subscribe("/joy", 1, &NeoOmniDriveNode::joy_callback, this);
 
 		m_srv_lock_platform = m_node_handle.advertiseService("lock_platform", &NeoOmniDriveNode::lock_platform, this);
 		m_srv_unlock_platform = m_node_handle.advertiseService("unlock_platform", &NeoOmniDriveNode::unlock_platform, this);
 		m_srv_reset_omni_wheels = m_node_handle.advertiseService("reset_omni_wheels", &NeoOmniDriveNode::reset_omni_wheels, this);
+		m_srv_get_pose_history = m_node_handle.advertiseService("get_pose_history", &NeoOmniDriveNode::get_pose_history, this);
 
 		m_kinematics = std::make_shared<OmniKinematics>(m_num_wheels);
 		m_velocity_solver = std::make_shared<VelocitySolver>(m_num_wheels);
+		m_pose_history = std::make_shared<PoseHistory>(std::max(m_pose_history_size, 2));
+
+		auto params = std::make_shared<kinematics_params_t>();
+		m_node_handle.param("zero_vel_threshold", params->zero_vel_threshold, 0.005);
+		m_node_handle.param("small_vel_threshold", params->small_vel_threshold, 0.03);
+		m_node_handle.param("steer_hysteresis", params->steer_hysteresis, 30.0);
+		m_node_handle.param("steer_hysteresis_dynamic", params->steer_hysteresis_dynamic, 5.0);
+		params->steer_hysteresis = M_PI * params->steer_hysteresis / 180;
+		params->steer_hysteresis_dynamic = M_PI * params->steer_hysteresis_dynamic / 180;
+		m_node_handle.param("steer_align_time", params->steer_align_time, 0.1);
+		m_node_handle.param("max_prediction_time", params->max_prediction_time, 0.1);
+		m_node_handle.param("latency_low_pass", params->latency_low_pass, 0.1);
+		m_node_handle.param("min_accel_dt", params->min_accel_dt, 0.01);
+		m_node_handle.param("accel_low_pass", params->accel_low_pass, 0.5);
+		m_node_handle.param("max_accel", params->max_accel, 1.0);
+		m_node_handle.param("max_yaw_accel", params->max_yaw_accel, 2.0);
+		m_node_handle.param("max_vel", params->max_vel, 0.);
+		m_node_handle.param("max_yaw_vel", params->max_yaw_vel, 0.);
+		std::atomic_store(&m_params, std::shared_ptr<const kinematics_params_t>(params));
+
+		// drive and steering limits, zero = unlimited
+		double max_wheel_vel = 0;
+		double max_steer_vel = 0;
+		m_node_handle.param("max_wheel_vel", max_wheel_vel, 0.);
+		m_node_handle.param("max_steer_vel", max_steer_vel, 0.);
 
-		m_node_handle.param("zero_vel_threshold", m_kinematics->zero_vel_threshold, 0.005);
-		m_node_handle.param("small_vel_threshold", m_kinematics->small_vel_threshold, 0.03);
-		m_node_handle.param("steer_hysteresis", m_kinematics->steer_hysteresis, 30.0);
-		m_node_handle.param("steer_hysteresis_dynamic", m_kinematics->steer_hysteresis_dynamic, 5.0);
-		m_kinematics->steer_hysteresis = M_PI * m_kinematics->steer_hysteresis / 180;
-		m_kinematics->steer_hysteresis_dynamic = M_PI * m_kinematics->steer_hysteresis_dynamic / 180;
+		for(int i = 0; i < m_num_wheels; ++i)
+		{
+			m_node_handle.param("drive" + std::to_string(i) + "/max_wheel_vel", m_kinematics->max_wheel_vel[i], max_wheel_vel);
+			m_node_handle.param("steer" + std::to_string(i) + "/max_steer_vel", m_kinematics->max_steer_vel[i], max_steer_vel);
+		}
 		m_kinematics->initialize(m_wheels);
+
+		// allow tuning at runtime, in private namespace since we share ours with neo_omnidrive_socketcan
+		m_reconfigure_server.reset(new dynamic_reconfigure::Server<neo_kinematics_omnidrive::OmniDriveConfig>(ros::NodeHandle("~")));
+		{
+			// seed with the values loaded above, instead of the defaults in the cfg file
+			neo_kinematics_omnidrive::OmniDriveConfig config;
+			m_reconfigure_server->getConfigDefault(config);
+			config.zero_vel_threshold = params->zero_vel_threshold;
+			config.small_vel_threshold = params->small_vel_threshold;
+			config.steer_hysteresis = 180 * params->steer_hysteresis / M_PI;
+			config.steer_hysteresis_dynamic = 180 * params->steer_hysteresis_dynamic / M_PI;
+			config.steer_align_time = params->steer_align_time;
+			config.max_prediction_time = params->max_prediction_time;
+			config.latency_low_pass = params->latency_low_pass;
+			config.min_accel_dt = params->min_accel_dt;
+			config.accel_low_pass = params->accel_low_pass;
+			config.max_accel = params->max_accel;
+			config.max_yaw_accel = params->max_yaw_accel;
+			config.max_vel = params->max_vel;
+			config.max_yaw_vel = params->max_yaw_vel;
+			m_reconfigure_server->updateConfig(config);
+		}
+		m_reconfigure_server->setCallback(boost::bind(&NeoOmniDriveNode::reconfigure_callback, this, _1, _2));
 	}
 
 	void control_step()
 	{
 		std::lock_guard<std::mutex> lock(m_node_mutex);
 
-		const ros::Time now = ros::Time::now();
+		// one consistent parameter set per cycle, see reconfigure_callback()
+		const std::shared_ptr<const kinematics_params_t> params = std::atomic_load(&m_params);
+		m_kinematics->zero_vel_threshold = params->zero_vel_threshold;
+		m_kinematics->small_vel_threshold = params->small_vel_threshold;
+		m_kinematics->steer_hysteresis = params->steer_hysteresis;
+		m_kinematics->steer_hysteresis_dynamic = params->steer_hysteresis_dynamic;
+		m_kinematics->steer_align_time = params->steer_align_time;
+
+		// timeouts use steady time, ROS time is only used for stamps
+		const steady_time_t now = get_steady_time();
 
 		// check for input timeout
-		if((now - m_last_cmd_time).toSec() > m_cmd_timeout)
+		if(to_seconds(now - m_last_cmd_time) > m_cmd_timeout)
 		{
-			if(!is_cmd_timeout && !m_last_cmd_time.isZero()
+			if(!is_cmd_timeout && m_last_cmd_time != steady_time_t()
 				&& (m_last_cmd_vel.linear.x != 0 || m_last_cmd_vel.linear.y != 0 || m_last_cmd_vel.angular.z != 0))
 			{
 				ROS_WARN_STREAM("cmd_vel input timeout! Stopping now.");
@@ -146,11 +259,62 @@ public:
 			m_last_cmd_vel = geometry_msgs::Twist();	// use zero cmd_vel
 		}
 
+		// in idle mode we only run at idle_rate
+		if(is_idle && to_seconds(now - m_last_control_time) < 0.99 / m_idle_rate) {
+			return;
+		}
+		m_last_control_time = now;
+
+		// compensate latency by predicting where the command will be when it reaches the motors
+		geometry_msgs::Twist cmd_vel = m_last_cmd_vel;
+		if(m_cmd_prediction && m_cmd_vel_stamped && !is_cmd_timeout && !is_locked)
+		{
+			const double cmd_age = (ros::Time::now() - m_last_cmd_stamp).toSec();
+			const double dt = fmin(fmax(cmd_age + m_cmd_latency, 0), params->max_prediction_time);
+
+			cmd_vel.linear.x = predict_cmd(m_last_cmd_vel.linear.x, m_cmd_accel.linear.x, dt, params->max_accel, params->max_vel);
+			cmd_vel.linear.y = predict_cmd(m_last_cmd_vel.linear.y, m_cmd_accel.linear.y, dt, params->max_accel, params->max_vel);
+			cmd_vel.angular.z = predict_cmd(m_last_cmd_vel.angular.z, m_cmd_accel.angular.z, dt, params->max_yaw_accel, params->max_yaw_vel);
+		}
+
 		// compute new wheel angles and velocities
-		auto cmd_wheels = m_kinematics->compute(m_wheels, m_last_cmd_vel.linear.x, m_last_cmd_vel.linear.y, m_last_cmd_vel.angular.z);
+		auto cmd_wheels = m_kinematics->compute(m_wheels, cmd_vel.linear.x, cmd_vel.linear.y, cmd_vel.angular.z);
+
+		// check if we can go to idle mode
+		{
+			bool is_active = m_last_cmd_vel.linear.x != 0 || m_last_cmd_vel.linear.y != 0 || m_last_cmd_vel.angular.z != 0;
+			for(int i = 0; i < m_num_wheels; ++i) {
+				if(m_kinematics->is_driving[i]) {
+					is_active = true;
+				}
+			}
+			if(is_active || m_idle_delay <= 0) {
+				m_last_active_time = now;
+				is_idle = false;
+			}
+			else if(!is_idle && to_seconds(now - m_last_active_time) > m_idle_delay) {
+				ROS_INFO_STREAM("Entering idle mode, reducing control rate to " << m_idle_rate << " Hz.");
+				is_idle = true;
+			}
+		}
+
+		// report how much the command had to be scaled down
+		if(m_kinematics->vel_scale < 1) {
+			ROS_DEBUG_STREAM("cmd_vel scaled by " << m_kinematics->vel_scale << " to stay within drive limits");
+		}
+		if(m_num_sub_vel_scale > 0)
+		{
+			std_msgs::Float64 vel_scale;
+			vel_scale.data = m_kinematics->vel_scale;
+			m_pub_vel_scale.publish(vel_scale);
+		}
+
+		if(m_num_sub_joint_trajectory == 0) {
+			return;
+		}
 
 		trajectory_msgs::JointTrajectory::Ptr joint_trajectory = boost::make_shared<trajectory_msgs::JointTrajectory>();
-		joint_trajectory->header.stamp = now;
+		joint_trajectory->header.stamp = ros::Time::now();
 
 		trajectory_msgs::JointTrajectoryPoint point;
 
@@ -173,12 +337,129 @@ public:
 		m_pub_joint_trajectory.publish(joint_trajectory);
 	}
 
+	/*
+	 * Returns true if we are in idle mode, in which case control_step() only needs to be called at get_idle_period().
+	 */
+	bool is_idle_mode()
+	{
+		std::lock_guard<std::mutex> lock(m_node_mutex);
+		return is_idle;
+	}
+
+	double get_idle_period() const
+	{
+		return 1 / m_idle_rate;
+	}
+
+	/*
+	 * Returns odometry pose and twist interpolated at given time.
+	 *
+	 * @return false if time is outside of history.
+	 */
+	bool get_pose(ros::Time time, PoseHistory::sample_t& pose)
+	{
+		std::lock_guard<std::mutex> lock(m_node_mutex);
+		return m_pose_history->get_sample(time.toSec(), pose);
+	}
+
 private:
+	void subscriber_callback(const ros::SingleSubscriberPublisher& pub)
+	{
+		std::lock_guard<std::mutex> lock(m_node_mutex);
+		m_num_sub_odometry = m_pub_odometry.getNumSubscribers();
+		m_num_sub_joint_trajectory = m_pub_joint_trajectory.getNumSubscribers();
+		m_num_sub_vel_scale = m_pub_vel_scale.getNumSubscribers();
+		m_num_sub_tf = m_broadcast_tf ? m_pub_tf.getNumSubscribers() : 0;
+	}
+
 	void cmd_vel_callback(const geometry_msgs::Twist& twist)
 	{
 		std::lock_guard<std::mutex> lock(m_node_mutex);
-		m_last_cmd_time = ros::Time::now();
+		m_last_cmd_time = get_steady_time();
 		m_last_cmd_vel = twist;
+
+		// wake up from idle mode
+		if(twist.linear.x != 0 || twist.linear.y != 0 || twist.angular.z != 0) {
+			is_idle = false;
+		}
+	}
+
+	/*
+	 * Publishes a new parameter set without locking m_node_mutex, control_step() picks it up on the next cycle.
+	 */
+	void reconfigure_callback(neo_kinematics_omnidrive::OmniDriveConfig& config, uint32_t level)
+	{
+		auto params = std::make_shared<kinematics_params_t>(*std::atomic_load(&m_params));
+		params->zero_vel_threshold = config.zero_vel_threshold;
+		params->small_vel_threshold = config.small_vel_threshold;
+		params->steer_hysteresis = M_PI * config.steer_hysteresis / 180;
+		params->steer_hysteresis_dynamic = M_PI * config.steer_hysteresis_dynamic / 180;
+		params->steer_align_time = config.steer_align_time;
+		params->max_prediction_time = config.max_prediction_time;
+		params->latency_low_pass = config.latency_low_pass;
+		params->min_accel_dt = config.min_accel_dt;
+		params->accel_low_pass = config.accel_low_pass;
+		params->max_accel = config.max_accel;
+		params->max_yaw_accel = config.max_yaw_accel;
+		params->max_vel = config.max_vel;
+		params->max_yaw_vel = config.max_yaw_vel;
+		std::atomic_store(&m_params, std::shared_ptr<const kinematics_params_t>(params));
+	}
+
+	void cmd_vel_stamped_callback(const geometry_msgs::TwistStamped& twist)
+	{
+		// use time of generation if available
+		const ros::Time stamp = twist.header.stamp.isZero() ? ros::Time::now() : twist.header.stamp;
+		{
+			std::lock_guard<std::mutex> lock(m_node_mutex);
+
+			// estimate derivative from an earlier command at least min_accel_dt ago, to avoid amplifying jitter
+			const std::shared_ptr<const kinematics_params_t> params = std::atomic_load(&m_params);
+			const double dt = (stamp - m_accel_ref_stamp).toSec();
+			if(is_cmd_timeout || m_accel_ref_stamp.isZero() || dt < 0 || dt > m_cmd_timeout)
+			{
+				m_cmd_accel = geometry_msgs::Twist();
+				m_accel_ref_vel = twist.twist;
+				m_accel_ref_stamp = stamp;
+			}
+			else if(dt >= fmax(params->min_accel_dt, 1e-3))
+			{
+				const double low_pass = params->accel_low_pass;
+				m_cmd_accel.linear.x = low_pass * (twist.twist.linear.x - m_accel_ref_vel.linear.x) / dt + (1 - low_pass) * m_cmd_accel.linear.x;
+				m_cmd_accel.linear.y = low_pass * (twist.twist.linear.y - m_accel_ref_vel.linear.y) / dt + (1 - low_pass) * m_cmd_accel.linear.y;
+				m_cmd_accel.angular.z = low_pass * (twist.twist.angular.z - m_accel_ref_vel.angular.z) / dt + (1 - low_pass) * m_cmd_accel.angular.z;
+				m_accel_ref_vel = twist.twist;
+				m_accel_ref_stamp = stamp;
+			}
+			m_last_cmd_stamp = stamp;
+		}
+		cmd_vel_callback(twist.twist);
+	}
+
+	void cmd_latency_callback(const std_msgs::Float64& latency)
+	{
+		std::lock_guard<std::mutex> lock(m_node_mutex);
+		const double low_pass = std::atomic_load(&m_params)->latency_low_pass;
+		if(latency.data >= 0 && latency.data < 1) {
+			m_cmd_latency = latency.data * low_pass + m_cmd_latency * (1 - low_pass);
+		}
+	}
+
+	/*
+	 * Extrapolates a command by dt seconds, without changing its sign (ie. a stop command stays a stop).
+	 * The rate is clamped to max_rate and the result to max_value, unless the command itself is larger (zero = unlimited).
+	 */
+	static double predict_cmd(double value, double rate, double dt, double max_rate, double max_value)
+	{
+		if(max_rate > 0) {
+			rate = fmin(fmax(rate, -max_rate), max_rate);
+		}
+		double res = value + rate * dt;
+		if(max_value > 0) {
+			const double limit = fmax(fabs(value), max_value);
+			res = fmin(fmax(res, -limit), limit);
+		}
+		return res * value > 0 ? res : 0;
 	}
 
 	void joint_state_callback(const sensor_msgs::JointState& joint_state)
@@ -196,44 +477,108 @@ private:
 			return;
 		}
 
+		std::vector<int> got_value(m_num_wheels);
+
 		// update wheels with new data
 		for(size_t i = 0; i < num_joints; ++i)
 		{
-			for(auto& wheel : m_wheels)
+			for(int k = 0; k < m_num_wheels; ++k)
 			{
+				auto& wheel = m_wheels[k];
+
 				if(joint_state.name[i] == wheel.drive_joint_name)
 				{
 					// update wheel velocity
 					wheel.wheel_vel = -1 * joint_state.velocity[i] * m_wheel_radius;
+					m_drive_pos[k] = joint_state.position[i];
+					got_value[k] |= 1;
 				}
 				if(joint_state.name[i] == wheel.steer_joint_name)
 				{
 					// update wheel steering angle and wheel position (due to lever arm)
 					wheel.set_wheel_angle(joint_state.position[i] + M_PI);
+					wheel.steer_vel = joint_state.velocity[i];
+					got_value[k] |= 2;
 				}
 			}
 		}
 
-		// compute velocities
-		m_velocity_solver->solve(m_wheels);
+		// modules missing in joint states have been disabled by the motor controller
+		for(int i = 0; i < m_num_wheels; ++i)
+		{
+			const bool is_enabled = got_value[i] == 3;
+
+			if(is_enabled != m_kinematics->is_enabled[i])
+			{
+				if(is_enabled) {
+					ROS_INFO_STREAM("Wheel module " << i << " enabled again.");
+				} else {
+					ROS_WARN_STREAM("Wheel module " << i << " disabled, continuing with remaining wheels.");
+				}
+			}
+			m_kinematics->is_enabled[i] = is_enabled;
+			m_velocity_solver->is_enabled[i] = is_enabled;
+		}
 
-		nav_msgs::Odometry::Ptr odometry = boost::make_shared<nav_msgs::Odometry>();
-		odometry->header.frame_id = "odom";
-		odometry->header.stamp = joint_state.header.stamp;
-		odometry->child_frame_id = "base_link";
+		const double dt = (joint_state.header.stamp - m_curr_odom_time).toSec();
 
-		// integrate odometry (using second order midpoint method)
-		if(!m_curr_odom_time.is_zero())
+		// use exact wheel travel since last update, with steering averaged over the interval
+		if(m_travel_odometry)
 		{
-			const double dt = (joint_state.header.stamp - m_curr_odom_time).toSec();
+			for(int i = 0; i < m_num_wheels; ++i)
+			{
+				const bool is_valid = got_value[i] == 3 && m_has_last_pos[i] && dt > 0;
+				if(is_valid)
+				{
+					const double wheel_angle = m_wheels[i].wheel_angle;
+					const double prev_angle = m_last_wheel_angle[i];
+					m_odom_wheels[i].set_wheel_angle(prev_angle + 0.5 * angles::shortest_angular_distance(prev_angle, wheel_angle));
+					m_odom_wheels[i].steer_vel = angles::shortest_angular_distance(prev_angle, wheel_angle) / dt;
+					m_odom_wheels[i].wheel_vel = -1 * (m_drive_pos[i] - m_last_drive_pos[i]) * m_wheel_radius / dt;
+				}
+				m_velocity_solver->is_enabled[i] = is_valid;
+
+				// remember for next interval
+				if(got_value[i] == 3)
+				{
+					m_last_drive_pos[i] = m_drive_pos[i];
+					m_last_wheel_angle[i] = m_wheels[i].wheel_angle;
+				}
+				m_has_last_pos[i] = got_value[i] == 3;
+			}
+
+			// wait for second update
+			if(m_curr_odom_time.isZero()) {
+				m_curr_odom_time = joint_state.header.stamp;
+				return;
+			}
+		}
+
+		if(m_velocity_solver->get_num_enabled() < 2) {
+			ROS_ERROR_STREAM_THROTTLE(1, "Not enough wheel modules to compute odometry!");
+			return;
+		}
+
+		// compute velocities
+		m_velocity_solver->solve(m_travel_odometry ? m_odom_wheels : m_wheels);
 
+		// integrate odometry (using second order midpoint method)
+		if(!m_curr_odom_time.isZero())
+		{
 			// check for valid delta time
 			if(dt > 0 && dt < 1)
 			{
-				// compute second order midpoint velocities
-				const double vel_x_mid = 0.5 * (m_velocity_solver->move_vel_x + m_curr_odom_twist.linear.x);
-				const double vel_y_mid = 0.5 * (m_velocity_solver->move_vel_y + m_curr_odom_twist.linear.y);
-				const double yawrate_mid = 0.5 * (m_velocity_solver->move_yawrate + m_curr_odom_twist.angular.z);
+				double vel_x_mid = m_velocity_solver->move_vel_x;
+				double vel_y_mid = m_velocity_solver->move_vel_y;
+				double yawrate_mid = m_velocity_solver->move_yawrate;
+
+				// compute second order midpoint velocities (travel odometry is a mean over the interval already)
+				if(!m_travel_odometry)
+				{
+					vel_x_mid = 0.5 * (vel_x_mid + m_curr_odom_twist.linear.x);
+					vel_y_mid = 0.5 * (vel_y_mid + m_curr_odom_twist.linear.y);
+					yawrate_mid = 0.5 * (yawrate_mid + m_curr_odom_twist.angular.z);
+				}
 
 				// compute midpoint yaw angle
 				const double yaw_mid = m_curr_odom_yaw + 0.5 * yawrate_mid * dt;
@@ -252,34 +597,58 @@ private:
 		}
 		m_curr_odom_time = joint_state.header.stamp;
 
-		// assign odometry pose
-		odometry->pose.pose.position.x = m_curr_odom_x;
-		odometry->pose.pose.position.y = m_curr_odom_y;
-		odometry->pose.pose.position.z = 0;
-		tf::quaternionTFToMsg(tf::createQuaternionFromYaw(m_curr_odom_yaw), odometry->pose.pose.orientation);
-
-		// assign odometry twist
+		// update odometry twist
 		m_curr_odom_twist.linear.x = m_velocity_solver->move_vel_x;
 		m_curr_odom_twist.linear.y = m_velocity_solver->move_vel_y;
 		m_curr_odom_twist.linear.z = 0;
 		m_curr_odom_twist.angular.x = 0;
 		m_curr_odom_twist.angular.y = 0;
 		m_curr_odom_twist.angular.z = m_velocity_solver->move_yawrate;
-		odometry->twist.twist = m_curr_odom_twist;
 
-		// assign bogus covariance values
-		odometry->pose.covariance.assign(0.1);
-		odometry->twist.covariance.assign(0.1);
+		// remember for later queries
+		{
+			PoseHistory::sample_t sample;
+			sample.time = joint_state.header.stamp.toSec();
+			sample.x = m_curr_odom_x;
+			sample.y = m_curr_odom_y;
+			sample.yaw = m_curr_odom_yaw;
+			sample.vel_x = m_curr_odom_twist.linear.x;
+			sample.vel_y = m_curr_odom_twist.linear.y;
+			sample.yawrate = m_curr_odom_twist.angular.z;
+			m_pose_history->add(sample);
+		}
 
 		// publish odometry
-		m_pub_odometry.publish(odometry);
-		odometry = 0;
+		if(m_num_sub_odometry > 0)
+		{
+			nav_msgs::Odometry::Ptr odometry = boost::make_shared<nav_msgs::Odometry>();
+			odometry->header.frame_id = "odom";
+			odometry->header.stamp = joint_state.header.stamp;
+			odometry->child_frame_id = "base_link";
+
+			// assign odometry pose
+			odometry->pose.pose.position.x = m_curr_odom_x;
+			odometry->pose.pose.position.y = m_curr_odom_y;
+			odometry->pose.pose.position.z = 0;
+			tf::quaternionTFToMsg(tf::createQuaternionFromYaw(m_curr_odom_yaw), odometry->pose.pose.orientation);
+
+			// assign odometry twist
+			odometry->twist.twist = m_curr_odom_twist;
+
+			// assign bogus covariance values
+			odometry->pose.covariance.assign(0.1);
+			odometry->twist.covariance.assign(0.1);
+
+			m_pub_odometry.publish(odometry);
+		}
 
 		// broadcast odometry
-		if(m_broadcast_tf)
+		if(m_broadcast_tf && m_num_sub_tf > 0)
 		{
 			// compose and publish transform for tf package
-			geometry_msgs::TransformStamped odom_tf;
+			tf::tfMessage::Ptr tf_msg = boost::make_shared<tf::tfMessage>();
+			tf_msg->transforms.resize(1);
+			geometry_msgs::TransformStamped& odom_tf = tf_msg->transforms[0];
 			// compose header
 			odom_tf.header.stamp = joint_state.header.stamp;
 			odom_tf.header.frame_id = "odom";
@@ -291,7 +660,7 @@ private:
 			tf::quaternionTFToMsg(tf::createQuaternionFromYaw(m_curr_odom_yaw), odom_tf.transform.rotation);
 
 			// publish the transform
-			m_tf_odom_broadcaster.sendTransform(odom_tf);
+			m_pub_tf.publish(tf_msg);
 		}
 	}
 
@@ -352,6 +721,35 @@ private:
 		return false;
 	}
 
+	bool get_pose_history(neo_kinematics_omnidrive::GetPoseHistory::Request& request, neo_kinematics_omnidrive::GetPoseHistory::Response& response)
+	{
+		std::lock_guard<std::mutex> lock(m_node_mutex);
+
+		const size_t count = request.stamps.size();
+		response.poses.resize(count);
+		response.twists.resize(count);
+		response.valid.resize(count);
+
+		for(size_t i = 0; i < count; ++i)
+		{
+			PoseHistory::sample_t sample;
+			response.valid[i] = m_pose_history->get_sample(request.stamps[i].toSec(), sample);
+
+			auto& pose = response.poses[i];
+			pose.header.stamp = request.stamps[i];
+			pose.header.frame_id = "odom";
+			pose.pose.position.x = sample.x;
+			pose.pose.position.y = sample.y;
+			tf::quaternionTFToMsg(tf::createQuaternionFromYaw(sample.yaw), pose.pose.orientation);
+
+			auto& twist = response.twists[i];
+			twist.linear.x = sample.vel_x;
+			twist.linear.y = sample.vel_y;
+			twist.angular.z = sample.yawrate;
+		}
+		return true;
+	}
+
 private:
 	std::mutex m_node_mutex;
 
@@ -359,16 +757,26 @@ private:
 
 	ros::Publisher m_pub_odometry;
 	ros::Publisher m_pub_joint_trajectory;
+	ros::Publisher m_pub_vel_scale;
+	ros::Publisher m_pub_tf;
 
 	ros::Subscriber m_sub_cmd_vel;
+	ros::Subscriber m_sub_cmd_latency;
 	ros::Subscriber m_sub_joint_state;
 	ros::Subscriber m_sub_joy;
 
 	ros::ServiceServer m_srv_lock_platform;
 	ros::ServiceServer m_srv_unlock_platform;
 	ros::ServiceServer m_srv_reset_omni_wheels;
+	ros::ServiceServer m_srv_get_pose_history;
+
+	std::unique_ptr<dynamic_reconfigure::Server<neo_kinematics_omnidrive::OmniDriveConfig>> m_reconfigure_server;
+	std::shared_ptr<const kinematics_params_t> m_params;		// read-copy-update, only access via std::atomic_load() / std::atomic_store()
 
-	tf::TransformBroadcaster m_tf_odom_broadcaster;
+	uint32_t m_num_sub_odometry = 0;
+	uint32_t m_num_sub_joint_trajectory = 0;
+	uint32_t m_num_sub_vel_scale = 0;
+	uint32_t m_num_sub_tf = 0;
 
 	bool m_broadcast_tf = false;
 	int m_num_wheels = 0;
@@ -377,17 +785,38 @@ private:
 	double m_wheel_radius = 0;
 	double m_wheel_lever_arm = 0;
 	double m_cmd_timeout = 0;
+	bool m_cmd_vel_stamped = false;
+	bool m_cmd_prediction = false;
+	bool m_travel_odometry = false;
+	int m_pose_history_size = 0;
 
 	std::vector<OmniWheel> m_wheels;
+	std::vector<OmniWheel> m_odom_wheels;		// wheels averaged over last interval (travel odometry)
+	std::vector<double> m_drive_pos;			// current drive positions (travel odometry) [rad]
+	std::vector<double> m_last_drive_pos;		// drive positions at last update (travel odometry) [rad]
+	std::vector<double> m_last_wheel_angle;		// wheel angles at last update (travel odometry) [rad]
+	std::vector<bool> m_has_last_pos;
 
 	std::shared_ptr<OmniKinematics> m_kinematics;
 	std::shared_ptr<VelocitySolver> m_velocity_solver;
+	std::shared_ptr<PoseHistory> m_pose_history;
 
-	ros::Time m_last_cmd_time;
+	steady_time_t m_last_cmd_time;
 	geometry_msgs::Twist m_last_cmd_vel;
+	ros::Time m_last_cmd_stamp;				// time of generation (cmd_vel_stamped)
+	geometry_msgs::Twist m_accel_ref_vel;		// command the derivative is estimated from
+	ros::Time m_accel_ref_stamp;
+	geometry_msgs::Twist m_cmd_accel;			// derivative of cmd_vel_stamped
+	double m_cmd_latency = 0;					// filtered latency from joint_trajectory to CAN transmit [s]
 	bool is_cmd_timeout = false;
 	bool is_locked = false;
 
+	double m_idle_delay = 0;
+	double m_idle_rate = 0;
+	bool is_idle = false;
+	steady_time_t m_last_control_time;
+	steady_time_t m_last_active_time;
+
 	ros::Time m_curr_odom_time;
 	double m_curr_odom_x = 0;
 	double m_curr_odom_y = 0;
@@ -415,11 +844,20 @@ int main(int argc, char** argv)
 
 		while(ros::ok())
 		{
-			ros::spinOnce();
+			const bool is_idle = node.is_idle_mode();
+
+			if(is_idle) {
+				// sleep until next idle cycle, but wake up immediately on new input
+				ros::getGlobalCallbackQueue()->callAvailable(ros::WallDuration(node.get_idle_period()));
+			} else {
+				ros::spinOnce();
+			}
 
 			node.control_step();
 
-			rate.sleep();
+			if(!is_idle) {
+				rate.sleep();
+			}
 		}
 	} catch(std::exception& ex) {
 		ROS_ERROR_STREAM("NeoOmniDriveNode: " << ex.what());
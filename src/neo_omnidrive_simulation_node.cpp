@@ -93,19 +93,21 @@ public:
 		}
 
 		//m_pub_odometry = m_node_handle.advertise<nav_msgs::Odometry>("/odom", 1);
-		fl_caster_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_caster_front_left_controller/command", 1);
-		bl_caster_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_caster_back_left_controller/command", 1);
-		br_caster_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_caster_back_right_controller/command", 1);
-		fr_caster_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_caster_front_right_controller/command", 1);
-		fl_drive_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_wheel_front_left_controller/command", 1);
-		bl_drive_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_wheel_back_left_controller/command", 1);
-		br_drive_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_wheel_back_right_controller/command", 1);
-		fr_drive_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_wheel_front_right_controller/command", 1);
-		
+		// keep track of subscribers, to skip publishing commands nobody listens to
+		const ros::SubscriberStatusCallback subscriber_callback = boost::bind(&NeoOmniDriveNode::subscriber_callback, this, _1);
+
+		fl_caster_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_caster_front_left_controller/command", 1, subscriber_callback, subscriber_callback);
+		bl_caster_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_caster_back_left_controller/command", 1, subscriber_callback, subscriber_callback);
+		br_caster_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_caster_back_right_controller/command", 1, subscriber_callback, subscriber_callback);
+		fr_caster_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_caster_front_right_controller/command", 1, subscriber_callback, subscriber_callback);
+		fl_drive_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_wheel_front_left_controller/command", 1, subscriber_callback, subscriber_callback);
+		bl_drive_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_wheel_back_left_controller/command", 1, subscriber_callback, subscriber_callback);
+		br_drive_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_wheel_back_right_controller/command", 1, subscriber_callback, subscriber_callback);
+		fr_drive_pub = m_node_handle.advertise<std_msgs::Float64>("/mpo_700_wheel_front_right_controller/command", 1, subscriber_callback, subscriber_callback);
 
 		m_sub_cmd_vel = m_node_handle.subscribe("/cmd_vel", 3, &NeoOmniDriveNode::cmd_vel_callback, this);
 		m_sub_joint_state = m_node_handle.subscribe("/joint_states", 10, &NeoOmniDriveNode::joint_state_callback, this);
-		m_pub_joint_trajectory = m_node_handle.advertise<trajectory_msgs::JointTrajectory>("/drives/joint_trajectory", 1);
+		m_pub_joint_trajectory = m_node_handle.advertise<trajectory_msgs::JointTrajectory>("/drives/joint_trajectory", 1, subscriber_callback, subscriber_callback);
 
 		m_kinematics = std::make_shared<OmniKinematics>(m_num_wheels);
 		m_velocity_solver = std::make_shared<VelocitySolver>(m_num_wheels);
@@ -122,8 +124,6 @@ public:
 	void control_step()
 	{
 		std::lock_guard<std::mutex> lock(m_node_mutex);
-		std_msgs::Float64 f1,f2,f3,f4,f5,f6,f7,f8;
-
 
 		const ros::Time now = ros::Time::now();
 
@@ -145,6 +145,22 @@ public:
 		// compute new wheel angles and velocities
 		auto cmd_wheels = m_kinematics->compute(m_wheels, m_last_cmd_vel.linear.x, m_last_cmd_vel.linear.y, m_last_cmd_vel.angular.z);
 
+		if(m_num_sub_commands > 0)
+		{
+			publish_command(fl_caster_pub, cmd_wheels[0].wheel_angle);
+			publish_command(bl_caster_pub, cmd_wheels[1].wheel_angle);
+			publish_command(br_caster_pub, cmd_wheels[2].wheel_angle);
+			publish_command(fr_caster_pub, cmd_wheels[3].wheel_angle);
+			publish_command(fl_drive_pub, cmd_wheels[0].wheel_vel / m_wheel_radius);
+			publish_command(bl_drive_pub, cmd_wheels[1].wheel_vel / m_wheel_radius);
+			publish_command(br_drive_pub, cmd_wheels[2].wheel_vel / m_wheel_radius);
+			publish_command(fr_drive_pub, cmd_wheels[3].wheel_vel / m_wheel_radius);
+		}
+
+		if(m_num_sub_joint_trajectory == 0) {
+			return;
+		}
+
 		trajectory_msgs::JointTrajectory::Ptr joint_trajectory = boost::make_shared<trajectory_msgs::JointTrajectory>();
 		joint_trajectory->header.stamp = now;
 
@@ -161,28 +177,28 @@ public:
 			point.velocities.push_back(0);
 		}
 		joint_trajectory->points.push_back(point);
-		// std::cout<<joint_trajectory->joint_names[7]<<std::endl;
-		f1.data = joint_trajectory->points[0].velocities[0];
-		f2.data = joint_trajectory->points[0].positions[1];
-		f3.data = joint_trajectory->points[0].velocities[2];
-		f4.data = joint_trajectory->points[0].positions[3];
-		f5.data = joint_trajectory->points[0].velocities[4];
-		f6.data = joint_trajectory->points[0].positions[5];
-		f7.data = joint_trajectory->points[0].velocities[6];
-		f8.data = joint_trajectory->points[0].positions[7];
-		fl_caster_pub.publish(f2);
-		bl_caster_pub.publish(f4);
-		br_caster_pub.publish(f6);
-		fr_caster_pub.publish(f8);
-		fl_drive_pub.publish(f1);
-		bl_drive_pub.publish(f3);
-		br_drive_pub.publish(f5);
-		fr_drive_pub.publish(f7);
 
 		m_pub_joint_trajectory.publish(joint_trajectory);
 	}
 
 private:
+	static void publish_command(const ros::Publisher& pub, double value)
+	{
+		std_msgs::Float64 command;
+		command.data = value;
+		pub.publish(command);
+	}
+
+	void subscriber_callback(const ros::SingleSubscriberPublisher& pub)
+	{
+		std::lock_guard<std::mutex> lock(m_node_mutex);
+		m_num_sub_joint_trajectory = m_pub_joint_trajectory.getNumSubscribers();
+		m_num_sub_commands = fl_caster_pub.getNumSubscribers() + bl_caster_pub.getNumSubscribers()
+				+ br_caster_pub.getNumSubscribers() + fr_caster_pub.getNumSubscribers()
+				+ fl_drive_pub.getNumSubscribers() + bl_drive_pub.getNumSubscribers()
+				+ br_drive_pub.getNumSubscribers() + fr_drive_pub.getNumSubscribers();
+	}
+
 	void cmd_vel_callback(const geometry_msgs::Twist& twist)
 	{
 		std::lock_guard<std::mutex> lock(m_node_mutex);
@@ -221,10 +237,12 @@ private:
 				{
 					// update wheel steering angle and wheel position (due to lever arm)
 					wheel.set_wheel_angle(joint_state.position[i] + M_PI);
+					wheel.steer_vel = joint_state.velocity[i];
 				}
 				if(joint_state.name[i] == wheel.steer_joint_name && i==0)
 				{
 					wheel.set_wheel_angle(joint_state.position[i] +  M_PI );
+					wheel.steer_vel = joint_state.velocity[i];
 				}
 			}
 		}
@@ -256,6 +274,9 @@ private:
 
 	tf::TransformBroadcaster m_tf_odom_broadcaster;
 
+	uint32_t m_num_sub_joint_trajectory = 0;
+	uint32_t m_num_sub_commands = 0;		// total over all joint controller command topics
+
 	bool m_broadcast_tf = false;
 	int m_num_wheels = 0;
 	int m_homeing_button = -1;
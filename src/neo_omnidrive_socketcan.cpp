@@ -32,21 +32,46 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  *********************************************************************/
 
+#include "../include/CanTxQueue.h"
+#include "../include/CanBusLoad.h"
+#include "../include/SteadyClock.h"
+#include "../include/SpscQueue.h"
+#include "../include/SeqLock.h"
+#include "../include/WheelTrajectory.h"
+
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <angles/angles.h>
 #include <sensor_msgs/JointState.h>
 #include <trajectory_msgs/JointTrajectory.h>
 #include <neo_msgs/EmergencyStopState.h>
 #include <sensor_msgs/Joy.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <dynamic_reconfigure/server.h>
+#include <neo_kinematics_omnidrive/SocketCanConfig.h>
+#include <std_msgs/Float64.h>
 
 #include <queue>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include <linux/can/error.h>
+#include <linux/can/netlink.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 #include <net/if.h>
+#include <poll.h>
+#include <semaphore.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -63,36 +88,80 @@ public:
 		ST_MOTOR_FAILURE
 	};
 
+	/*
+	 * Measured motor values, written by receive_loop() for every SYNC without locking m_node_mutex.
+	 */
+	struct motor_rx_t
+	{
+		int64_t curr_enc_travel_inc = 0;		// continuous (unwrapped) encoder position in ticks
+		steady_time_t update_recv_time;			// time of last sync update received
+		double curr_torque = 0;					// current measure motor torque
+		int32_t curr_enc_pos_inc = 0;			// current encoder position value in ticks
+		int32_t curr_enc_vel_inc_s = 0;			// current encoder velocity value in ticks/s
+		uint16_t curr_status_word = 0;			// current CiA 402 status word as received by TPDO1
+		uint8_t curr_error_register = 0;		// last error register as received by EMCY msg or TPDO1
+		bool has_enc_pos = false;				// if curr_enc_pos_inc is valid for unwrapping
+	};
+
+	/*
+	 * Motor config and state, grouped by writer thread.
+	 * Config is not modified after initialize(), fields read by receive_loop() for every frame come first.
+	 */
 	struct motor_t
 	{
-		std::string joint_name;					// ROS joint name
+		int bus = 0;							// CAN bus index
 		int32_t can_id = -1;					// motor "CAN ID"
-		int32_t rot_sign = 0;					// motor rotation direction
-		int32_t enc_ticks_per_rev = 0;			// encoder ticks per motor revolution
-		int32_t enc_home_offset = 0;			// encoder offset for true home position
-		int32_t max_vel_enc_s = 500000;			// max motor velocity in ticks/s (positive)
-		int32_t max_accel_enc_s = 1000000;		// max motor acceleration in ticks/s^2 (positive)
+		int32_t can_EMCY = -1;
 		int32_t can_Tx_PDO1 = -1;
+		int32_t can_Rx_PDO1 = -1;
 		int32_t can_Tx_PDO2 = -1;
 		int32_t can_Rx_PDO2 = -1;
 		int32_t can_Tx_SDO = -1;
 		int32_t can_Rx_SDO = -1;
+		int32_t can_NMT_EC = -1;
+		int32_t rot_sign = 0;					// motor rotation direction
+		int32_t enc_ticks_per_rev = 0;			// encoder ticks per motor revolution
+		int32_t enc_modulo_inc = 0;				// position counter modulo range in ticks (0 = full int32 range)
 		double gear_ratio = 0;					// gear ratio
 		double torque_constant = 0;				// conversion factor from current to torque
+		double rated_current = 0;				// motor rated current in A (for current via TPDO1)
+		int32_t enc_home_offset = 0;			// encoder offset for true home position
+		int32_t max_vel_enc_s = 500000;			// max motor velocity in ticks/s (positive)
+		int32_t max_accel_enc_s = 1000000;		// max motor acceleration in ticks/s^2 (positive)
+		int setpoint_slot = -1;					// index in shared setpoint frame
+		std::string joint_name;					// ROS joint name
+
+		// written by receive thread for every SYNC (hot)
+		SeqLock<motor_rx_t> rx;
 
+		// written by handle() on events, with m_node_mutex locked
 		motor_state_e state = ST_PRE_INITIALIZED;
-		int32_t curr_enc_pos_inc = 0;			// current encoder position value in ticks
-		int32_t curr_enc_vel_inc_s = 0;			// current encoder velocity value in ticks/s
+		uint16_t curr_status_word = 0;			// last status word evaluated by handle()
 		int32_t curr_status = 0;				// current status as received by SR msg
 		int32_t curr_motor_failure = 0;			// current motor failure status as received by MF msg
-		double curr_torque = 0;					// current measure motor torque
-		ros::Time request_send_time;			// time of last status update request
-		ros::Time status_recv_time;				// time of last status update received
-		ros::Time update_recv_time;				// time of last sync update received
-		ros::Time homing_start_time;			// time of homing start
+		uint16_t curr_emcy_code = 0;			// last error code as received by EMCY msg (0 = no error)
+		uint32_t num_emcy_warnings = 0;			// number of EMCY msgs which were only warnings
+		int32_t nmt_state = -1;					// NMT state as received by heartbeat msg (-1 = unknown)
 		int homing_state = -1;					// current homing state (-2 = restart, -1 = unknown, 0 = active, 1 = finished, 2 = done)
+		int32_t homing_token = 0;				// homing token as received by UI[1] msg (0 = unknown)
+		steady_time_t status_recv_time;			// time of last status update received
+		steady_time_t heartbeat_recv_time;		// time of last heartbeat received
+
+		// written by control thread
+		steady_time_t request_send_time;		// time of last status update request
+		steady_time_t homing_start_time;		// time of homing start
 	};
 
+	enum motor_group_e
+	{
+		GROUP_ALL,
+		GROUP_DRIVE,
+		GROUP_STEER
+	};
+
+	/*
+	 * Module config and state, grouped by writer thread like motor_t.
+	 */
 	struct module_t
 	{
 		motor_t drive;
@@ -101,21 +170,93 @@ public:
 		int32_t home_dig_in = 0;				// digital input for homing switch
 		double home_angle = 0;					// home steering angle in rad
 
+		// written by control thread
 		double target_wheel_vel = 0;			// current wheel velocity target in rad/s
 		double target_steer_pos = 0;			// current steering target angle in rad
 		double control_wheel_vel = 0;			// last commanded wheel velocity in rad/s
 		double control_steer_vel = 0;			// last commanded steering velocity in rad/s
-		double curr_wheel_pos = 0;				// current wheel angle in rad
+		double curr_wheel_pos = 0;				// current wheel angle in rad, see update_wheel_states()
 		double curr_wheel_vel = 0;				// current wheel velocity in rad/s
 		double curr_steer_pos = 0;				// current steering angle in rad
 		double curr_steer_vel = 0;				// current steering velocity in rad/s
+		bool is_enabled = true;					// if module is used (false = disabled due to failure in degraded mode)
 	};
 
 	struct can_msg_t
 	{
+		int bus = -1;							// CAN bus index (-1 = all)
 		int id = -1;
-		int length = 0;
-		uint8_t data[8] = {};
+		int length = 0;							// up to 8 bytes, or 64 bytes in CAN FD mode
+		uint8_t data[64] = {};
+		steady_time_t time;						// receive time
+	};
+
+	typedef CanTxQueue<can_msg_t> tx_queue_t;
+
+	struct wheel_sample_t
+	{
+		bool is_enabled = false;
+		double wheel_pos = 0;					// in rad
+		double wheel_vel = 0;					// in rad/s
+		double steer_pos = 0;					// in rad (including home_angle)
+		double steer_vel = 0;					// in rad/s
+		double drive_torque = 0;
+		double steer_torque = 0;
+		int32_t drive_enc_pos = 0;				// in ticks
+		int32_t drive_enc_vel = 0;				// in ticks/s
+		int32_t steer_enc_pos = 0;
+		int32_t steer_enc_vel = 0;
+	};
+
+	struct joint_sample_t
+	{
+		ros::Time stamp;
+		bool has_joint_state = false;			// if joint_states should be published
+		bool has_joint_state_raw = false;		// if joint_states_raw should be published
+		std::vector<wheel_sample_t> wheels;
+	};
+
+	struct can_bus_t
+	{
+		int index = -1;
+		std::string iface;
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::atomic<int> sock {-1};
+		std::atomic<bool> is_recovering {false};		// set by receive_loop() while socket is down or bus-off
+		std::chrono::steady_clock::time_point error_time;
+
+		std::mutex tx_mutex;
+		tx_queue_t tx_queue {256};
+
+		std::vector<int32_t> setpoints;				// shared setpoint frame (CAN FD)
+		bool has_setpoints = false;
+
+		CanBusLoad tx_load;							// protected by tx_mutex
+		std::mutex rx_load_mutex;
+		CanBusLoad rx_load;
+
+		SpscQueue<can_msg_t> rx_mailbox {1024};		// msgs for handle() while m_node_mutex is busy
+		joint_sample_t joint_sample;				// producer buffer of receive_loop(), see push_joint_sample()
+		std::unique_ptr<SpscQueue<joint_sample_t>> joint_queue;		// to publish_loop()
+		std::vector<motor_rx_t> rx_snapshot;		// used by check_update_done()
+		std::atomic<int64_t> max_latency_us {0};	// max time from kernel receive to processed
+	};
+
+	/*
+	 * Control parameters which can be changed at runtime via dynamic_reconfigure.
+	 * Never modified once published, see m_params.
+	 */
+	struct control_params_t
+	{
+		double steer_gain = 0;
+		double steer_lookahead = 0;
+		double steer_low_pass = 0;
+		double max_steer_vel = 0;
+		double drive_low_pass = 0;
+		double trajectory_timeout = 0;
+		double degraded_vel_scale = 0;
 	};
 
 	NeoSocketCanNode()
@@ -132,28 +273,101 @@ public:
 		m_node_handle.param("request_status_divider", m_request_status_divider, 10);
 		m_node_handle.param("heartbeat_divider", m_heartbeat_divider, 10);
 		m_node_handle.param("motor_group_id", m_motor_group_id, -1);
+		m_node_handle.param("drive_group_id", m_drive_group_id, -1);
+		m_node_handle.param("steer_group_id", m_steer_group_id, -1);
+		m_node_handle.param("group_id_object", m_group_id_object, 0x2040);
 		m_node_handle.param("motor_timeout", m_motor_timeout, 1.);
+		m_node_handle.param("motor_heartbeat_ms", m_motor_heartbeat_ms, 0);
+		m_node_handle.param("can_tx_queue_size", m_can_tx_queue_size, 256);
+		m_node_handle.param("can_retry_min_ms", m_can_retry_min_ms, 5);
+		m_node_handle.param("can_retry_max_ms", m_can_retry_max_ms, 1000);
+		m_node_handle.param("can_bitrate", m_can_bitrate, 1000000);
+		m_node_handle.param("can_fd", m_can_fd, false);
+		m_node_handle.param("can_fd_brs", m_can_fd_brs, true);
+		m_node_handle.param("can_data_bitrate", m_can_data_bitrate, m_can_bitrate);
+		if(m_can_data_bitrate < m_can_bitrate) {
+			throw std::logic_error("invalid can_data_bitrate param");
+		}
+		add_bus(m_can_iface);		// default bus
+		m_node_handle.param("shared_setpoints", m_shared_setpoints, false);
+		m_node_handle.param("shared_rpdo_id", m_shared_rpdo_id, 0x200);
+		m_node_handle.param("tpdo1_mapping", m_tpdo1_mapping, std::vector<int>{0x60640020, 0x60690020});
 		m_node_handle.param("home_vel", m_home_vel, -1.);
-		m_node_handle.param("steer_gain", m_steer_gain, 1.);
-		m_node_handle.param("steer_lookahead", m_steer_lookahead, 0.1);
-		m_node_handle.param("steer_low_pass", m_steer_low_pass, 0.5);
-		m_node_handle.param("max_steer_vel", m_max_steer_vel, 10.);
-		m_node_handle.param("drive_low_pass", m_drive_low_pass, 0.5);
+		auto params = std::make_shared<control_params_t>();
+		m_node_handle.param("steer_gain", params->steer_gain, 1.);
+		m_node_handle.param("steer_lookahead", params->steer_lookahead, 0.1);
+		m_node_handle.param("phase_aligned_control", m_phase_aligned_control, false);
+		m_node_handle.param("pdo_timeout", m_pdo_timeout, 0.005);
+		m_node_handle.param("steer_low_pass", params->steer_low_pass, 0.5);
+		m_node_handle.param("max_steer_vel", params->max_steer_vel, 10.);
+		m_node_handle.param("drive_low_pass", params->drive_low_pass, 0.5);
 		m_node_handle.param("motor_delay", m_motor_delay, 0.);
-		m_node_handle.param("trajectory_timeout", m_trajectory_timeout, 0.1);
+		m_node_handle.param("trajectory_timeout", params->trajectory_timeout, 0.1);
 		m_node_handle.param("auto_home", m_auto_home, true);
 		m_node_handle.param("measure_torque", m_measure_torque, false);
+		m_node_handle.param("travel_odometry", m_travel_odometry, false);
+		m_node_handle.param("rpdo_setpoints", m_rpdo_setpoints, false);
+		m_node_handle.param("set_mode_of_operation", m_set_mode_of_operation, false);
+
+		// check PDO layout
+		{
+			int num_bits = 0;
+			for(const int entry : m_tpdo1_mapping)
+			{
+				const int bits = entry & 0xFF;
+				if(bits == 0 || bits > 32 || bits % 8) {
+					throw std::logic_error("invalid tpdo1_mapping entry: " + std::to_string(entry));
+				}
+				if((entry >> 16) == 0x6078) {
+					m_has_pdo_current = true;
+				}
+				num_bits += bits;
+			}
+			if(num_bits > (m_can_fd ? 512 : 64)) {
+				throw std::logic_error("tpdo1_mapping exceeds PDO size");
+			}
+		}
+		if(m_shared_setpoints && !(m_can_fd && m_rpdo_setpoints)) {
+			throw std::logic_error("shared_setpoints requires can_fd and rpdo_setpoints");
+		}
+		m_node_handle.param("idle_delay", m_idle_delay, 5.);
+		m_node_handle.param("idle_rate", m_idle_rate, 10.);
+		m_node_handle.param("homing_state_file", m_homing_state_file, std::string());
 		m_node_handle.param("homeing_button", m_homeing_button, 0);
+		m_node_handle.param("degraded_mode", m_degraded_mode, false);
+		m_node_handle.param("degraded_vel_scale", params->degraded_vel_scale, 0.5);
+		std::atomic_store(&m_params, std::shared_ptr<const control_params_t>(params));
+
+		// heartbeat needs to be sent at least at normal rate, to keep motor watchdog satisfied
+		m_idle_rate = fmax(m_idle_rate, m_control_rate / m_heartbeat_divider);
+
+		// wait at most half a cycle for PDO replies, to leave time for control and transmit
+		m_pdo_timeout = fmin(m_pdo_timeout, 0.5 / m_control_rate);
 
 		if(m_motor_group_id >= 0) {
 			ROS_INFO_STREAM("Using motor group id: " << m_motor_group_id);
 			m_motor_group_id += 0x300;
 		}
+		if(m_drive_group_id >= 0) {
+			ROS_INFO_STREAM("Using drive group id: " << m_drive_group_id);
+			m_drive_group_id += 0x300;
+		}
+		if(m_steer_group_id >= 0) {
+			ROS_INFO_STREAM("Using steer group id: " << m_steer_group_id);
+			m_steer_group_id += 0x300;
+		}
 
 		if(m_num_wheels < 1) {
 			throw std::logic_error("invalid num_wheels param");
 		}
+		m_node_handle.param("degraded_min_wheels", m_degraded_min_wheels, m_num_wheels - 1);
+		m_degraded_min_wheels = std::max(m_degraded_min_wheels, 2);		// need at least two wheels for odometry
+		if(m_num_wheels > 32) {
+			throw std::logic_error("num_wheels > 32");		// see m_enabled_mask
+		}
 		m_wheels.resize(m_num_wheels);
+		m_traj_wheel_vel.resize(m_num_wheels);
+		m_traj_steer_pos.resize(m_num_wheels);
 
 		for(int i = 0; i < m_num_wheels; ++i)
 		{
@@ -196,27 +410,130 @@ public:
 			if(!m_node_handle.getParam("steer" + std::to_string(i) + "/enc_home_offset", m_wheels[i].steer.enc_home_offset)) {
 				throw std::logic_error("enc_home_offset param missing for steering motor" + std::to_string(i));
 			}
+			m_wheels[i].drive.bus = get_bus_index("drive" + std::to_string(i) + "/can_iface");
+			m_wheels[i].steer.bus = get_bus_index("steer" + std::to_string(i) + "/can_iface");
+
 			m_node_handle.param("drive" + std::to_string(i) + "/torque_constant", m_wheels[i].drive.torque_constant, 0.);
 			m_node_handle.param("steer" + std::to_string(i) + "/torque_constant", m_wheels[i].steer.torque_constant, 0.);
+			m_node_handle.param("drive" + std::to_string(i) + "/rated_current", m_wheels[i].drive.rated_current, 0.);
+			m_node_handle.param("steer" + std::to_string(i) + "/rated_current", m_wheels[i].steer.rated_current, 0.);
 
 			m_wheels[i].home_angle = M_PI * m_wheels[i].home_angle / 180.;
 		}
 
-		m_pub_joint_state = m_node_handle.advertise<sensor_msgs::JointState>("/drives/joint_states", 10);
-		m_pub_joint_state_raw = m_node_handle.advertise<sensor_msgs::JointState>("/drives/joint_states_raw", 10);
+		// keep track of subscribers, to skip building messages nobody listens to
+		const ros::SubscriberStatusCallback subscriber_callback = boost::bind(&NeoSocketCanNode::subscriber_callback, this, _1);
+
+
+		m_pub_joint_state = m_node_handle.advertise<sensor_msgs::JointState>("/drives/joint_states", 10, subscriber_callback, subscriber_callback);
+		m_pub_joint_state_raw = m_node_handle.advertise<sensor_msgs::JointState>("/drives/joint_states_raw", 10, subscriber_callback, subscriber_callback);
+
+		m_pub_diagnostics = m_node_handle.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 10);
+		m_pub_cmd_latency = m_node_handle.advertise<std_msgs::Float64>("/drives/cmd_latency", 10);
 
 		m_sub_joint_trajectory = m_node_handle.subscribe("/drives/joint_trajectory", 1, &NeoSocketCanNode::joint_trajectory_callback, this);
 		m_sub_emergency_stop = m_node_handle.subscribe("emergency_stop_state", 1, &NeoSocketCanNode::emergency_stop_callback, this);
 		m_sub_joy = m_node_handle.subscribe("/joy", 1, &NeoSocketCanNode::joy_callback, this);
 
-		m_can_thread = std::thread(&NeoSocketCanNode::receive_loop, this);
+		// allow tuning of control parameters at runtime, in private namespace since we share ours with neo_omnidrive_node
+		m_reconfigure_server.reset(new dynamic_reconfigure::Server<neo_kinematics_omnidrive::SocketCanConfig>(ros::NodeHandle("~")));
+		{
+			// seed with the values loaded above, instead of the defaults in the cfg file
+			neo_kinematics_omnidrive::SocketCanConfig config;
+			m_reconfigure_server->getConfigDefault(config);
+			config.steer_gain = params->steer_gain;
+			config.steer_lookahead = params->steer_lookahead;
+			config.steer_low_pass = params->steer_low_pass;
+			config.max_steer_vel = params->max_steer_vel;
+			config.drive_low_pass = params->drive_low_pass;
+			config.trajectory_timeout = params->trajectory_timeout;
+			config.degraded_vel_scale = params->degraded_vel_scale;
+			m_reconfigure_server->updateConfig(config);
+		}
+		m_reconfigure_server->setCallback(boost::bind(&NeoSocketCanNode::reconfigure_callback, this, _1, _2));
+
+		// assign slots in shared setpoint frame, in order of motors per bus
+		if(m_shared_setpoints)
+		{
+			for(auto& wheel : m_wheels)
+			{
+				for(motor_t* motor : {&wheel.drive, &wheel.steer})
+				{
+					auto& setpoints = m_buses[motor->bus]->setpoints;
+					if(setpoints.size() >= 16) {
+						throw std::logic_error("too many motors for shared setpoint frame on " + m_buses[motor->bus]->iface);
+					}
+					motor->setpoint_slot = setpoints.size();
+					setpoints.push_back(0);
+				}
+			}
+		}
+
+		// joint states are published by a separate thread, to keep the receive threads responsive
+		for(auto& bus : m_buses)
+		{
+			bus->joint_sample.wheels.resize(m_num_wheels);
+			bus->joint_queue.reset(new SpscQueue<joint_sample_t>(16, bus->joint_sample));
+		}
+		::sem_init(&m_publish_sem, 0, 0);
+		m_publish_thread = std::thread(&NeoSocketCanNode::publish_loop, this);
+
+		// msgs queued by process_event() are handled as soon as m_node_mutex is free
+		::sem_init(&m_mailbox_sem, 0, 0);
+		m_mailbox_thread = std::thread(&NeoSocketCanNode::mailbox_loop, this);
+
+		update_enabled_mask();
+
+		for(auto& bus : m_buses)
+		{
+			bus->tx_queue = tx_queue_t(m_can_tx_queue_size);
+			bus->rx_snapshot.resize(2 * m_num_wheels);
+			bus->thread = std::thread(&NeoSocketCanNode::receive_loop, this, std::ref(*bus));
+		}
 	}
 
 	void update()
 	{
-		std::lock_guard<std::mutex> lock(m_node_mutex);
+		std::unique_lock<std::mutex> lock(m_node_mutex);
+
+		// handle msgs received while we were busy
+		process_mailboxes();
+
+		// take one snapshot per cycle, ROS time is only used for stamps
+		const steady_time_t now = get_steady_time();
+
+		// in idle mode we only run at idle_rate
+		if(is_idle && to_seconds(now - m_last_sync_time.load()) < 0.99 / m_idle_rate) {
+			return;
+		}
+		m_clock_map.update(now, ros::Time::now().toSec());
+
+		// resume after CAN bus recovery
+		if(m_is_can_reattached)
+		{
+			m_is_can_reattached = false;
+			reattach(now);
+		}
+
+		// in phase aligned mode send SYNC first and wait for the replies, so control runs on fresh data
+		bool is_sync_sent = false;
+		if(m_phase_aligned_control && !is_idle)
+		{
+			const auto deadline = now + std::chrono::microseconds(int64_t(m_pdo_timeout * 1e6));
+
+			send_sync();
+			can_flush(m_pdo_timeout);
+			is_sync_sent = true;
+
+			std::unique_lock<std::mutex> update_lock(m_update_mutex);
+			m_update_condition.wait_until(update_lock, deadline, [this]() { return m_last_update_time.load() >= m_last_sync_time.load(); });
+			update_lock.unlock();
 
-		const ros::Time now = ros::Time::now();
+			process_mailboxes();
+		}
+
+		// get latest measured values
+		update_wheel_states();
 
 		// check for motor timeouts
 		for(auto& wheel : m_wheels)
@@ -225,8 +542,11 @@ public:
 			check_motor_timeout(wheel.steer, now);
 		}
 
+		// check if we can continue with a failed module
+		check_degraded_mode();
+
 		// check if we should stop motion
-		if(!all_motors_operational())
+		if(!is_platform_operational())
 		{
 			stop_motion();
 		}
@@ -244,7 +564,7 @@ public:
 		// check if we are stopped
 		is_stopped = true;
 		for(const auto& wheel : m_wheels) {
-			if(std::abs(wheel.drive.curr_enc_vel_inc_s) > 100) {
+			if(std::abs(wheel.drive.rx.load().curr_enc_vel_inc_s) > 100) {
 				is_stopped = false;
 			}
 		}
@@ -252,7 +572,7 @@ public:
 		// check if we should start homing
 		if(m_auto_home && !is_all_homed && m_sync_counter > 100)
 		{
-			start_homing();
+			start_homing(now);
 		}
 
 		// check if homing done
@@ -263,7 +583,7 @@ public:
 				ROS_ERROR_STREAM("Homing has been interrupted!");
 				is_homing_active = false;
 			}
-			else if(check_homing_done())
+			else if(check_homing_done(now))
 			{
 				finish_homing();
 				ROS_INFO_STREAM("Homing successful!");
@@ -302,70 +622,82 @@ public:
 		}
 
 		// steering and motion control
-		if(is_all_homed && all_motors_operational())
+		bool is_setpoint_sent = false;
+		if(is_all_homed && is_platform_operational())
 		{
-			// check for input timeout
-			if((now - m_last_trajectory_time).toSec() > m_trajectory_timeout)
+			// one consistent parameter set per cycle, see reconfigure_callback()
+			const std::shared_ptr<const control_params_t> params = std::atomic_load(&m_params);
+
+			// check for input timeout, we keep executing a trajectory until the end of its horizon
+			const double trajectory_horizon = fmax(m_trajectory.get_end_time() - to_seconds(m_last_trajectory_time.time_since_epoch()), 0);
+
+			// in idle mode we only check every idle period, so allow for two of our cycles at least
+			const double cycle_period = is_idle ? get_idle_period() : 1 / m_control_rate;
+			const double trajectory_timeout = fmax(params->trajectory_timeout, 2 * cycle_period);
+
+			if(to_seconds(now - m_last_trajectory_time) > trajectory_horizon + trajectory_timeout)
 			{
-				if(!is_trajectory_timeout && !m_last_trajectory_time.isZero()) {
+				if(!is_trajectory_timeout && m_last_trajectory_time != steady_time_t() && !is_target_stop()) {
 					ROS_WARN_STREAM("joint_trajectory input timeout! Stopping now.");
 				}
 				is_trajectory_timeout = true;
 			}
 			else {
 				is_trajectory_timeout = false;
+				sample_trajectory(now);
 			}
 
+			// reduce speed in case we lost a module
+			const double vel_scale = get_num_enabled() < m_num_wheels ? params->degraded_vel_scale : 1;
+
 			for(auto& wheel : m_wheels)
 			{
+				if(!wheel.is_enabled) {
+					continue;						// disabled modules are held by check_degraded_mode()
+				}
 				if(is_trajectory_timeout) {
 					wheel.target_wheel_vel = 0;		// stop when input timed out
 				}
 
-				const double future_steer_pos = wheel.curr_steer_pos + wheel.curr_steer_vel * m_steer_lookahead;
+				const double future_steer_pos = wheel.curr_steer_pos + wheel.curr_steer_vel * params->steer_lookahead;
 				const double delta_rad = angles::shortest_angular_distance(wheel.target_steer_pos, future_steer_pos);
-				const double control_vel = -1 * delta_rad * m_steer_gain;
+				const double control_vel = -1 * delta_rad * params->steer_gain;
 
-				wheel.control_wheel_vel = wheel.target_wheel_vel * m_drive_low_pass + wheel.control_wheel_vel * (1 - m_drive_low_pass);
-				wheel.control_steer_vel = control_vel * m_steer_low_pass + wheel.control_steer_vel * (1 - m_steer_low_pass);
+				wheel.control_wheel_vel = vel_scale * wheel.target_wheel_vel * params->drive_low_pass + wheel.control_wheel_vel * (1 - params->drive_low_pass);
+				wheel.control_steer_vel = control_vel * params->steer_low_pass + wheel.control_steer_vel * (1 - params->steer_low_pass);
 
 				motor_set_vel(wheel.drive, wheel.control_wheel_vel);
-				motor_set_vel(wheel.steer, fmin(fmax(wheel.control_steer_vel, -m_max_steer_vel), m_max_steer_vel));
+				motor_set_vel(wheel.steer, fmin(fmax(wheel.control_steer_vel, -params->max_steer_vel), params->max_steer_vel));
 			}
 			begin_motion();
+			is_setpoint_sent = !is_trajectory_timeout;
 		}
 
+		// check if we can go to idle mode
+		check_idle_mode(now);
+
 		// check for update timeout
-		if(m_last_update_time < m_last_sync_time)
+		if(m_last_update_time.load() < m_last_sync_time.load())
 		{
 			if(is_all_homed) {
 				ROS_DEBUG_STREAM("Sync update timeout!");
 			}
 		}
 
-		// request current motor values
-		{
-			can_msg_t msg;
-			msg.id  = 0x80;
-			msg.length = 0;
-			can_transmit(msg);
+		// setpoints are applied on next SYNC (or on receipt in phase aligned mode)
+		if(m_shared_setpoints) {
+			send_shared_setpoints();
 		}
 
-		m_last_sync_time = ros::Time::now();
-		m_sync_counter++;
+		// request current motor values
+		if(!is_sync_sent) {
+			send_sync();
+		}
 
 		// measure torque if enabled
-		if(m_measure_torque)
+		if(m_measure_torque && !m_has_pdo_current)
 		{
-			if(m_motor_group_id >= 0) {
-				canopen_query(m_motor_group_id, 'I', 'Q', 0);	// query motor current
-			}
-			else {
-				for(auto& wheel : m_wheels) {
-					canopen_query(wheel.drive, 'I', 'Q', 0);	// query motor current
-					canopen_query(wheel.steer, 'I', 'Q', 0);	// query motor current
-				}
-			}
+			group_query(GROUP_ALL, 'I', 'Q', 0);		// query motor current
 		}
 
 		// check if we need to request status
@@ -374,31 +706,71 @@ public:
 			for(auto& wheel : m_wheels)
 			{
 				if((m_sync_counter + i + 0) % m_request_status_divider == 0) {
-					request_status(wheel.drive);		// request status update
+					request_status(wheel.drive, now);		// request status update
 				}
 				if((m_sync_counter + i + 1) % m_request_status_divider == 0) {
-					request_status(wheel.steer);		// request status update
+					request_status(wheel.steer, now);		// request status update
 				}
 				i += 2;
 			}
 		}
 
-		// check if we need to send a heartbeat
-		if((m_sync_counter + 2 * m_num_wheels) % m_heartbeat_divider == 0)
+		// check if we need to send a heartbeat (every cycle in idle mode)
+		if(is_idle || (m_sync_counter + 2 * m_num_wheels) % m_heartbeat_divider == 0)
 		{
 			can_msg_t msg;				// send heartbeat message
 			msg.id  = 0x700;
 			msg.length = 5;
 			can_transmit(msg);
 		}
+
+		// wait for queued messages to go out, at most half a cycle
+		can_flush(0.5 / m_control_rate);
+
+		// measure latency from trajectory generation to CAN transmit, for command prediction upstream
+		if(is_setpoint_sent && is_new_trajectory)
+		{
+			std_msgs::Float64 latency;
+			latency.data = (get_ros_time(get_steady_time()) - m_trajectory_stamp).toSec();
+			m_pub_cmd_latency.publish(latency);
+			is_new_trajectory = false;
+		}
+
+		publish_bus_load(now);
 	}
 
-	void initialize()
+	/*
+	 * Returns true if we are in idle mode, in which case update() only needs to be called at get_idle_period().
+	 */
+	bool is_idle_mode()
+	{
+		std::lock_guard<std::mutex> lock(m_node_mutex);
+		return is_idle;
+	}
+
+	double get_idle_period() const
+	{
+		return 1 / m_idle_rate;
+	}
+
+	/*
+	 * Returns true if initialize() needs to be called (again), ie. in case a drive rebooted.
+	 */
+	bool is_reinit_required()
 	{
 		std::lock_guard<std::mutex> lock(m_node_mutex);
+		return !is_initialized || m_boot_counter != m_init_boot_counter;
+	}
+
+	void initialize()
+	{
+		std::unique_lock<std::mutex> lock(m_node_mutex);
 
 		ROS_INFO_STREAM("Initializing ...");
 
+		is_initialized = false;
+		m_init_boot_counter = m_boot_counter;
+
 		// wait for CAN socket to be available
 		m_wait_for_can_sock = true;
 
@@ -412,19 +784,23 @@ public:
 		is_homing_active = false;
 		is_steer_reset_active = false;
 
-		// start network
-		{
-			can_msg_t msg;
-			msg.id = 0;
-			msg.length = 2;
-			msg.data[0] = 1;
-			msg.data[1] = 0;
-			can_transmit(msg);
-		}
+		start_network();
 		can_sync();
 
 		::usleep(100 * 1000);
 
+		// configure group ids
+		for(auto& wheel : m_wheels)
+		{
+			if(m_drive_group_id >= 0) {
+				canopen_SDO_download(wheel.drive, m_group_id_object, 0, m_drive_group_id - 0x300);
+			}
+			if(m_steer_group_id >= 0) {
+				canopen_SDO_download(wheel.steer, m_group_id_object, 0, m_steer_group_id - 0x300);
+			}
+		}
+		can_sync();
+
 		all_motors_off();
 
 		stop_motion();
@@ -447,11 +823,16 @@ public:
 		}
 		can_sync();
 
-		// set position counter to zero
+		// check if steering motors are still homed from last run
+		const bool is_still_homed = check_homing_state(lock);
+
+		// set position counter to zero (keep absolute position of homed steering motors)
 		for(auto& wheel : m_wheels)
 		{
 			reset_pos_counter(wheel.drive);
-			reset_pos_counter(wheel.steer);
+			if(!is_still_homed) {
+				reset_pos_counter(wheel.steer);
+			}
 		}
 		can_sync();
 
@@ -466,9 +847,32 @@ public:
 		}
 		can_sync();
 
+		// configure drives as heartbeat producers
+		if(m_motor_heartbeat_ms > 0)
+		{
+			for(auto& wheel : m_wheels)
+			{
+				configure_heartbeat(wheel.drive);
+				configure_heartbeat(wheel.steer);
+			}
+		}
+
 		all_motors_on();
 
-		request_status_all();
+		request_status_all(get_steady_time());
+
+		if(is_still_homed)
+		{
+			// activate watchdog, as done after homing
+			for(auto& wheel : m_wheels)
+			{
+				configure_watchdog(wheel.drive);
+				configure_watchdog(wheel.steer);
+			}
+			is_all_homed = true;
+			ROS_INFO_STREAM("Motors are still homed, skipping homing.");
+		}
+		is_initialized = true;
 
 		ROS_INFO_STREAM("Initializing done.");
 	}
@@ -491,20 +895,84 @@ public:
 				// ignore
 			}
 		}
+		for(auto& bus : m_buses)
 		{
-			std::lock_guard<std::mutex> lock(m_can_mutex);
+			std::lock_guard<std::mutex> lock(bus->mutex);
 			do_run = false;
-			if(m_can_sock >= 0) {
-				::close(m_can_sock);
-				m_can_sock = -1;
+			if(bus->sock >= 0) {
+				::close(bus->sock);
+				bus->sock = -1;
+			}
+		}
+		for(auto& bus : m_buses)
+		{
+			if(bus->thread.joinable()) {
+				bus->thread.join();
 			}
 		}
-		if(m_can_thread.joinable()) {
-			m_can_thread.join();
+		do_run = false;
+		::sem_post(&m_publish_sem);				// wake up publish_loop()
+		if(m_publish_thread.joinable()) {
+			m_publish_thread.join();
+		}
+		::sem_post(&m_mailbox_sem);				// wake up mailbox_loop()
+		if(m_mailbox_thread.joinable()) {
+			m_mailbox_thread.join();
 		}
 	}
 
 private:
+	/*
+	 * Returns index of bus with given interface, adds a new one if needed.
+	 */
+	int add_bus(const std::string& iface)
+	{
+		for(const auto& bus : m_buses) {
+			if(bus->iface == iface) {
+				return bus->index;
+			}
+		}
+		std::unique_ptr<can_bus_t> bus(new can_bus_t());
+		bus->index = m_buses.size();
+		bus->iface = iface;
+		bus->tx_load.data_bit_time = double(m_can_bitrate) / m_can_data_bitrate;
+		bus->rx_load.data_bit_time = bus->tx_load.data_bit_time;
+		m_buses.push_back(std::move(bus));
+		return m_buses.back()->index;
+	}
+
+	/*
+	 * Returns bus index for optional interface param, default is can_iface.
+	 */
+	int get_bus_index(const std::string& param)
+	{
+		std::string iface;
+		m_node_handle.param(param, iface, m_can_iface);
+		return add_bus(iface);
+	}
+
+	void subscriber_callback(const ros::SingleSubscriberPublisher& pub)
+	{
+		m_num_sub_joint_state = m_pub_joint_state.getNumSubscribers();
+		m_num_sub_joint_state_raw = m_pub_joint_state_raw.getNumSubscribers();
+	}
+
+	/*
+	 * Publishes a new parameter set without locking m_node_mutex, update() picks it up on the next cycle.
+	 */
+	void reconfigure_callback(neo_kinematics_omnidrive::SocketCanConfig& config, uint32_t level)
+	{
+		auto params = std::make_shared<control_params_t>(*std::atomic_load(&m_params));
+		params->steer_gain = config.steer_gain;
+		params->steer_lookahead = config.steer_lookahead;
+		params->steer_low_pass = config.steer_low_pass;
+		params->max_steer_vel = config.max_steer_vel;
+		params->drive_low_pass = config.drive_low_pass;
+		params->trajectory_timeout = config.trajectory_timeout;
+		params->degraded_vel_scale = config.degraded_vel_scale;
+		std::atomic_store(&m_params, std::shared_ptr<const control_params_t>(params));
+	}
+
 	void joint_trajectory_callback(const trajectory_msgs::JointTrajectory& joint_trajectory)
 	{
 		std::lock_guard<std::mutex> lock(m_node_mutex);
@@ -515,7 +983,7 @@ private:
 		}
 
 		// check if we are fully operational
-		if(!all_motors_operational()) {
+		if(!is_platform_operational()) {
 			return;
 		}
 
@@ -526,45 +994,95 @@ private:
 			return;
 		}
 
-		std::vector<double> wheel_vel(m_num_wheels);
-		std::vector<double> wheel_angle(m_num_wheels);
-		std::vector<int> got_value(m_num_wheels);
+		const steady_time_t now = get_steady_time();
+		const ros::Time ros_now = ros::Time::now();
+		m_clock_map.update(now, ros_now.toSec());
+
+		// trajectory starts at header stamp, or immediately if not set
+		const ros::Time start_time = joint_trajectory.header.stamp.isZero() ? ros_now : joint_trajectory.header.stamp;
 
-		for(size_t i = 0; i < joint_trajectory.joint_names.size(); ++i)
+		std::vector<WheelTrajectory::point_t> points(joint_trajectory.points.size());
+		bool is_motion = false;
+
+		for(size_t j = 0; j < joint_trajectory.points.size(); ++j)
 		{
-			for(int k = 0; k < m_num_wheels; ++k)
+			const auto& in = joint_trajectory.points[j];
+			auto& point = points[j];
+			point.time = to_seconds(m_clock_map.to_steady((start_time + in.time_from_start).toSec()).time_since_epoch());
+			point.wheel_vel.resize(m_num_wheels);
+			point.steer_pos.resize(m_num_wheels);
+
+			std::vector<int> got_value(m_num_wheels);
+
+			for(size_t i = 0; i < joint_trajectory.joint_names.size(); ++i)
 			{
-				if(joint_trajectory.joint_names[i] == m_wheels[k].drive.joint_name) {
-					if(joint_trajectory.points[0].velocities.size() > i) {
-						wheel_vel[k] = joint_trajectory.points[0].velocities[i];
-						got_value[k] |= 1;
+				for(int k = 0; k < m_num_wheels; ++k)
+				{
+					if(joint_trajectory.joint_names[i] == m_wheels[k].drive.joint_name) {
+						if(in.velocities.size() > i) {
+							point.wheel_vel[k] = in.velocities[i];
+							got_value[k] |= 1;
+						}
 					}
-				}
-				if(joint_trajectory.joint_names[i] == m_wheels[k].steer.joint_name) {
-					if(joint_trajectory.points[0].positions.size() > i) {
-						wheel_angle[k] = joint_trajectory.points[0].positions[i];
-						got_value[k] |= 2;
+					if(joint_trajectory.joint_names[i] == m_wheels[k].steer.joint_name) {
+						if(in.positions.size() > i) {
+							point.steer_pos[k] = in.positions[i] - m_wheels[k].home_angle;
+							got_value[k] |= 2;
+						}
 					}
 				}
 			}
-		}
 
-		// check that we have new values for every motor
-		for(int i = 0; i < m_num_wheels; ++i) {
-			if(got_value[i] != 3) {
-				ROS_WARN_STREAM("Invalid JointTrajectory message!");
-				stop_motion();
-				return;
+			// check that we have new values for every motor
+			for(int i = 0; i < m_num_wheels; ++i) {
+				if(got_value[i] != 3 && m_wheels[i].is_enabled) {
+					ROS_WARN_STREAM("Invalid JointTrajectory message!");
+					stop_motion();
+					return;
+				}
+			}
+
+			// any new motion wakes us up from idle mode
+			for(int i = 0; i < m_num_wheels; ++i) {
+				if(point.wheel_vel[i] != 0 || fabs(angles::shortest_angular_distance(m_wheels[i].target_steer_pos, point.steer_pos[i])) > 0.01) {
+					is_motion = true;
+				}
 			}
 		}
 
-		// apply new commands
+		try {
+			m_trajectory.set(points);
+		}
+		catch(const std::exception& ex) {
+			ROS_WARN_STREAM("Invalid JointTrajectory message: " << ex.what());
+			stop_motion();
+			return;
+		}
+
+		if(is_motion) {
+			wake_up(now);
+		}
+		m_last_trajectory_time = now;
+		m_trajectory_stamp = joint_trajectory.header.stamp.isZero() ? ros_now : joint_trajectory.header.stamp;
+		is_new_trajectory = true;
+
+		// apply first setpoint right away, in case we are in idle mode
+		sample_trajectory(now);
+	}
+
+	/*
+	 * Sets wheel targets by interpolating the buffered trajectory at given time.
+	 */
+	void sample_trajectory(steady_time_t now)
+	{
+		if(!m_trajectory.sample(to_seconds(now.time_since_epoch()), m_traj_wheel_vel, m_traj_steer_pos)) {
+			return;
+		}
 		for(int i = 0; i < m_num_wheels; ++i)
 		{
-			m_wheels[i].target_wheel_vel = wheel_vel[i];
-			m_wheels[i].target_steer_pos = wheel_angle[i] - m_wheels[i].home_angle;
+			m_wheels[i].target_wheel_vel = m_traj_wheel_vel[i];
+			m_wheels[i].target_steer_pos = m_traj_steer_pos[i];
 		}
-		m_last_trajectory_time = ros::Time::now();
 	}
 
 	void emergency_stop_callback(const neo_msgs::EmergencyStopState::ConstPtr& state)
@@ -575,17 +1093,22 @@ private:
 		{
 			ROS_INFO_STREAM("Reactivating motors ...");
 
+			const steady_time_t now = get_steady_time();
+			wake_up(now);
+
 			// reset states
 			for(auto& wheel : m_wheels)
 			{
 				wheel.drive.state = ST_PRE_INITIALIZED;
 				wheel.steer.state = ST_PRE_INITIALIZED;
+				wheel.is_enabled = true;			// give failed modules another chance
 			}
+			update_enabled_mask();
 			is_motor_reset = true;
 
 			all_motors_on();			// re-activate the motors
 
-			request_status_all();		// request new status
+			request_status_all(now);		// request new status
 		}
 
 		is_em_stop = state->emergency_state != neo_msgs::EmergencyStopState::EMFREE;
@@ -599,15 +1122,28 @@ private:
 		{
 			if(joy->buttons[m_homeing_button])
 			{
-				start_homing();
+				const steady_time_t now = get_steady_time();
+				wake_up(now);
+				start_homing(now);
 			}
 		}
 	}
 
-	void check_motor_timeout(motor_t& motor, ros::Time now)
+	void check_motor_timeout(motor_t& motor, steady_time_t now)
 	{
-		if(motor.status_recv_time < motor.request_send_time
-			&& (now - motor.request_send_time).toSec() > m_motor_timeout)
+		if(m_motor_heartbeat_ms > 0)
+		{
+			// fail after missing 3 heartbeats
+			if(to_seconds(now - motor.heartbeat_recv_time) > 3e-3 * m_motor_heartbeat_ms)
+			{
+				if(motor.state != ST_MOTOR_FAILURE) {
+					ROS_ERROR_STREAM(motor.joint_name << ": motor heartbeat timeout!");
+				}
+				motor.state = ST_MOTOR_FAILURE;
+			}
+		}
+		else if(motor.status_recv_time < motor.request_send_time
+			&& to_seconds(now - motor.request_send_time) > m_motor_timeout)
 		{
 			if(motor.state != ST_MOTOR_FAILURE) {
 				ROS_ERROR_STREAM(motor.joint_name << ": motor status timeout!");
@@ -627,77 +1163,199 @@ private:
 		return !is_em_stop;
 	}
 
-	void start_homing()
+	/*
+	 * Switches to idle mode after being stopped without input for idle_delay.
+	 */
+	void check_idle_mode(steady_time_t now)
 	{
-		if(is_homing_active || !is_stopped || !all_motors_operational()) {
-			return;
-		}
-		ROS_INFO_STREAM("Start homing procedure ...");
-
-		stop_motion();
-
-		disable_watchdog_all();
+		bool is_active = !is_all_homed || is_homing_active || is_steer_reset_active
+							|| !is_stopped || !is_target_stop();
 
-		for(auto& wheel : m_wheels)
+		for(const auto& wheel : m_wheels)
 		{
-			// disarm homing
-			canopen_set_int(wheel.steer, 'H', 'M', 1, 0);
-			can_sync();
-
-			// configure homing sequences
-			// setting the value such that increment counter resets after the homing event occurs
-			canopen_set_int(wheel.steer, 'H', 'M', 2, wheel.steer.enc_home_offset);
-			can_sync();
-
-			// choosing channel/switch on which controller has to listen for change of homing event(high/low/falling/rising)
-			canopen_set_int(wheel.steer, 'H', 'M', 3, wheel.home_dig_in);
-			can_sync();
-
-			// choose the action that the controller shall perform after the homing event occurred
-			// HM[4] = 0 : after Event stop immediately
-			// HM[4] = 2 : do nothing
-			canopen_set_int(wheel.steer, 'H', 'M', 4, 2);
-			can_sync();
-
-			// choose the setting of the position counter (i.e. to the value defined in 2.a) after the homing event occured
-			// HM[5] = 0 : absolute setting of position counter: PX = HM[2]
-			canopen_set_int(wheel.steer, 'H', 'M', 5, 0);
-			can_sync();
+			if(fabs(wheel.control_wheel_vel) > 1e-3 || fabs(wheel.control_steer_vel) > 1e-3) {
+				is_active = true;
+			}
 		}
-
-		// start turning motors
-		for(auto& wheel : m_wheels)
+		if(is_active || m_idle_delay <= 0)
 		{
-			motor_set_vel(wheel.drive, 0);
-			motor_set_vel(wheel.steer, m_home_vel);
+			m_last_active_time = now;
+			return;
 		}
-		can_sync();
-
-		begin_motion();
-
-		// arm homing
-		for(auto& wheel : m_wheels)
+		if(!is_idle && to_seconds(now - m_last_active_time) > m_idle_delay)
 		{
-			arm_homing(wheel.steer);
+			ROS_INFO_STREAM("Entering idle mode, reducing cycle rate from " << m_control_rate << " Hz to " << m_idle_rate << " Hz.");
+			is_idle = true;
+			m_idle_start_time = now;
+			m_idle_start_sync_counter = m_sync_counter;
+		}
+	}
+
+	/*
+	 * Returns true if no wheel is supposed to drive.
+	 */
+	bool is_target_stop() const
+	{
+		for(const auto& wheel : m_wheels) {
+			if(wheel.target_wheel_vel != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/*
+	 * Returns to full rate, the next call to update() will do a full cycle.
+	 */
+	void wake_up(steady_time_t now)
+	{
+		if(is_idle)
+		{
+			const double idle_time = to_seconds(now - m_idle_start_time);
+			const uint64_t num_cycles = m_sync_counter - m_idle_start_sync_counter;
+			ROS_INFO_STREAM("Leaving idle mode after " << idle_time << " sec, ran " << num_cycles << " instead of "
+					<< uint64_t(idle_time * m_control_rate) << " cycles.");
+			is_idle = false;
+		}
+		m_last_active_time = now;
+	}
+
+	bool is_module_operational(const module_t& wheel) const
+	{
+		return wheel.drive.state == ST_OPERATION_ENABLED && wheel.steer.state == ST_OPERATION_ENABLED;
+	}
+
+	int get_num_enabled() const
+	{
+		int count = 0;
+		for(const auto& wheel : m_wheels) {
+			count += wheel.is_enabled ? 1 : 0;
+		}
+		return count;
+	}
+
+	/*
+	 * Returns true if all enabled modules are operational and we have enough of them.
+	 */
+	bool is_platform_operational() const
+	{
+		for(const auto& wheel : m_wheels)
+		{
+			if(wheel.is_enabled && !is_module_operational(wheel)) {
+				return false;
+			}
+		}
+		const int num_enabled = get_num_enabled();
+		if(num_enabled < m_num_wheels && (!m_degraded_mode || num_enabled < m_degraded_min_wheels)) {
+			return false;
+		}
+		return !is_em_stop;
+	}
+
+	/*
+	 * Disables modules with a failed motor, in case degraded mode is allowed.
+	 * The drive of a disabled module is switched off (freewheeling), while the steering is held.
+	 */
+	void check_degraded_mode()
+	{
+		if(!m_degraded_mode || !is_all_homed || is_homing_active || is_em_stop) {
+			return;
+		}
+		for(int i = 0; i < m_num_wheels; ++i)
+		{
+			auto& wheel = m_wheels[i];
+
+			if(!wheel.is_enabled) {
+				if(wheel.steer.state == ST_OPERATION_ENABLED) {
+					motor_set_vel(wheel.steer, 0);		// keep holding steering
+				}
+				continue;
+			}
+			if(wheel.drive.state != ST_MOTOR_FAILURE && wheel.steer.state != ST_MOTOR_FAILURE) {
+				continue;
+			}
+			if(get_num_enabled() - 1 < m_degraded_min_wheels) {
+				continue;			// not enough modules left, need to stop
+			}
+			ROS_ERROR_STREAM("Disabling wheel module " << i << ", continuing in degraded mode with reduced speed.");
+
+			wheel.is_enabled = false;
+			update_enabled_mask();
+			wheel.target_wheel_vel = 0;
+			wheel.control_wheel_vel = 0;
+			wheel.control_steer_vel = 0;
+
+			if(wheel.drive.state != ST_MOTOR_FAILURE) {
+				motor_off(wheel.drive);				// let it roll freely
+			}
+			if(wheel.steer.state == ST_OPERATION_ENABLED) {
+				motor_set_vel(wheel.steer, 0);
+			}
+		}
+	}
+
+	void start_homing(steady_time_t now)
+	{
+		if(is_homing_active || !is_stopped || !all_motors_operational()) {
+			return;
+		}
+		ROS_INFO_STREAM("Start homing procedure ...");
+
+		invalidate_homing_state();
+
+		stop_motion();
+
+		disable_watchdog_all();
+
+		// disarm homing
+		group_set_int(GROUP_STEER, 'H', 'M', 1, 0);
+
+		for(auto& wheel : m_wheels)
+		{
+			// configure homing sequences
+			// setting the value such that increment counter resets after the homing event occurs
+			canopen_set_int(wheel.steer, 'H', 'M', 2, wheel.steer.enc_home_offset);
+
+			// choosing channel/switch on which controller has to listen for change of homing event(high/low/falling/rising)
+			canopen_set_int(wheel.steer, 'H', 'M', 3, wheel.home_dig_in);
+		}
+
+		// choose the action that the controller shall perform after the homing event occurred
+		// HM[4] = 0 : after Event stop immediately
+		// HM[4] = 2 : do nothing
+		group_set_int(GROUP_STEER, 'H', 'M', 4, 2);
+
+		// choose the setting of the position counter (i.e. to the value defined in 2.a) after the homing event occured
+		// HM[5] = 0 : absolute setting of position counter: PX = HM[2]
+		group_set_int(GROUP_STEER, 'H', 'M', 5, 0);
+
+		// start turning steering motors only
+		for(auto& wheel : m_wheels)
+		{
+			motor_set_vel(wheel.steer, m_home_vel);
+		}
+		begin_motion(GROUP_STEER);
+
+		// arm homing
+		for(auto& wheel : m_wheels)
+		{
+			arm_homing(wheel.steer, now);
 		}
-		can_sync();
 
 		is_all_homed = false;
 		is_homing_active = true;
 	}
 
-	void arm_homing(motor_t& motor)
+	void arm_homing(motor_t& motor, steady_time_t now)
 	{
 		motor.homing_state = -1;		// reset state
-		motor.homing_start_time = ros::Time::now();
+		motor.homing_start_time = now;
 
 		canopen_set_int(motor, 'H', 'M', 1, 1);		// arm homeing
 	}
 
-	bool check_homing_done()
+	bool check_homing_done(steady_time_t now)
 	{
-		const ros::Time now = ros::Time::now();
-
 		for(auto& wheel : m_wheels)
 		{
 			// check if we can stop wheels
@@ -710,15 +1368,15 @@ private:
 			// check for restart
 			if(wheel.steer.homing_state == -2)
 			{
-				arm_homing(wheel.steer);
+				arm_homing(wheel.steer, now);
 			}
 
 			// check for timeout
-			if((now - wheel.steer.homing_start_time).toSec() > 20)
+			if(to_seconds(now - wheel.steer.homing_start_time) > 20)
 			{
 				ROS_WARN_STREAM("Homeing timeout on motor " << wheel.steer.joint_name << ", restarting ...");				
 
-				arm_homing(wheel.steer);
+				arm_homing(wheel.steer, now);
 			}
 		}
 
@@ -746,18 +1404,244 @@ private:
 		is_all_homed = true;
 		is_homing_active = false;
 		is_steer_reset_active = true;
-		m_last_trajectory_time = ros::Time();
+		m_last_trajectory_time = steady_time_t();
+		m_trajectory.clear();
+
+		save_homing_state();
+	}
+
+	/*
+	 * Stores a random token in the steering motors (UI[1], which is cleared on power loss)
+	 * and writes it to homing_state_file together with the homing parameters.
+	 */
+	void save_homing_state()
+	{
+		if(m_homing_state_file.empty()) {
+			return;
+		}
+		std::random_device random;
+		int32_t token = 0;
+		while(token == 0) {
+			token = int32_t(random());
+		}
+
+		for(auto& wheel : m_wheels)
+		{
+			canopen_set_int(wheel.steer, 'U', 'I', 1, token);
+		}
+		can_sync();
+
+		std::ofstream file(m_homing_state_file, std::ios::trunc);
+		file << "token " << token << std::endl;
+		for(const auto& wheel : m_wheels)
+		{
+			file << "steer " << wheel.steer.can_id << " " << wheel.steer.enc_home_offset << " " << wheel.home_dig_in << std::endl;
+		}
+		if(!file.good()) {
+			ROS_WARN_STREAM("Failed to write homing state to " << m_homing_state_file);
+		}
+	}
+
+	void invalidate_homing_state()
+	{
+		if(!m_homing_state_file.empty()) {
+			std::remove(m_homing_state_file.c_str());
+		}
+	}
+
+	/*
+	 * Checks if the steering motors are still homed from a previous run, ie. they have not been power cycled
+	 * and the homing parameters did not change.
+	 * Needs to release the lock while waiting for replies.
+	 */
+	bool check_homing_state(std::unique_lock<std::mutex>& lock)
+	{
+		if(m_homing_state_file.empty()) {
+			return false;
+		}
+		int32_t token = 0;
+		{
+			std::ifstream file(m_homing_state_file);
+			std::string key;
+			if(!(file >> key >> token) || key != "token" || token == 0) {
+				return false;
+			}
+			for(const auto& wheel : m_wheels)
+			{
+				int32_t can_id = -1;
+				int32_t enc_home_offset = 0;
+				int32_t home_dig_in = 0;
+				if(!(file >> key >> can_id >> enc_home_offset >> home_dig_in) || key != "steer"
+					|| can_id != wheel.steer.can_id || enc_home_offset != wheel.steer.enc_home_offset
+					|| home_dig_in != wheel.home_dig_in)
+				{
+					ROS_INFO_STREAM("Homing parameters changed, need to re-home.");
+					return false;
+				}
+			}
+		}
+
+		// query token from motors
+		for(auto& wheel : m_wheels)
+		{
+			wheel.steer.homing_token = 0;
+			canopen_query(wheel.steer, 'U', 'I', 1);
+		}
+
+		// wait for replies
+		for(int i = 0; i < 20; ++i)
+		{
+			lock.unlock();
+			::usleep(10 * 1000);
+			lock.lock();
+			process_mailboxes();
+
+			bool is_all_received = true;
+			for(const auto& wheel : m_wheels) {
+				if(wheel.steer.homing_token == 0) {
+					is_all_received = false;
+				}
+			}
+			if(is_all_received) {
+				break;
+			}
+		}
+
+		for(const auto& wheel : m_wheels)
+		{
+			if(wheel.steer.homing_token != token) {
+				ROS_INFO_STREAM(wheel.steer.joint_name << ": lost homing (token mismatch), need to re-home.");
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/*
+	 * Publishes bus load and traffic per COB-ID class for each bus, at 1 Hz.
+	 */
+	void publish_bus_load(steady_time_t now)
+	{
+		const double delta = to_seconds(now - m_last_load_time);
+		if(delta < 1) {
+			return;
+		}
+		const uint64_t num_cycles = m_sync_counter - m_last_load_sync_counter;
+		const bool is_valid = m_last_load_time != steady_time_t() && num_cycles > 0;
+
+		diagnostic_msgs::DiagnosticArray::Ptr out = boost::make_shared<diagnostic_msgs::DiagnosticArray>();
+		out->header.stamp = get_ros_time(now);
+
+		for(auto& bus : m_buses)
+		{
+			CanBusLoad tx_load;
+			CanBusLoad rx_load;
+			{
+				std::lock_guard<std::mutex> lock(bus->tx_mutex);
+				tx_load = bus->tx_load;
+				bus->tx_load.clear();
+			}
+			{
+				std::lock_guard<std::mutex> lock(bus->rx_load_mutex);
+				rx_load = bus->rx_load;
+				bus->rx_load.clear();
+			}
+			if(!is_valid) {
+				continue;
+			}
+			const double bits_per_sec = delta * m_can_bitrate;
+			const double load = (tx_load.get_total().num_bits + rx_load.get_total().num_bits) / bits_per_sec;
+
+			diagnostic_msgs::DiagnosticStatus status;
+			status.name = "neo_omnidrive_socketcan: " + bus->iface;
+			status.hardware_id = bus->iface;
+			status.message = std::to_string(int(100 * load)) + " % load";
+			if(bus->is_recovering) {
+				status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+				status.message += ", recovering";
+			}
+			else if(load > 0.8) {
+				status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+				ROS_WARN_STREAM_THROTTLE(10, "CAN bus '" << bus->iface << "' is at " << int(100 * load) << " % load");
+			}
+			else {
+				status.level = diagnostic_msgs::DiagnosticStatus::OK;
+			}
+			add_key_value(status, "load [%]", 100 * load);
+			add_key_value(status, "tx frames/cycle", double(tx_load.get_total().num_frames) / num_cycles);
+			add_key_value(status, "rx frames/cycle", double(rx_load.get_total().num_frames) / num_cycles);
+			add_key_value(status, "tx frames/s", tx_load.get_total().num_frames / delta);
+			add_key_value(status, "rx frames/s", rx_load.get_total().num_frames / delta);
+			add_key_value(status, "max frame latency [ms]", bus->max_latency_us.exchange(0) * 1e-3);
+
+			for(const auto& entry : tx_load.get_classes()) {
+				add_key_value(status, "tx " + CanBusLoad::get_class_name(entry.first) + " [%]", 100 * entry.second.num_bits / bits_per_sec);
+			}
+			for(const auto& entry : rx_load.get_classes()) {
+				add_key_value(status, "rx " + CanBusLoad::get_class_name(entry.first) + " [%]", 100 * entry.second.num_bits / bits_per_sec);
+			}
+			out->status.push_back(status);
+		}
+		if(is_valid) {
+			m_pub_diagnostics.publish(out);
+		}
+		m_last_load_time = now;
+		m_last_load_sync_counter = m_sync_counter;
+	}
+
+	static void add_key_value(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, double value)
+	{
+		diagnostic_msgs::KeyValue pair;
+		pair.key = key;
+		pair.value = std::to_string(value);
+		status.values.push_back(pair);
+	}
+
+	/*
+	 * Resumes operation after the CAN bus recovered, without a full initialize().
+	 * Motors may have been stopped by the heartbeat watchdog in the meantime.
+	 */
+	void reattach(steady_time_t now)
+	{
+		ROS_INFO_STREAM("Resuming operation ...");
+
+		start_network();
+
+		if(!is_em_stop)
+		{
+			for(auto& wheel : m_wheels)
+			{
+				wheel.drive.state = ST_PRE_INITIALIZED;
+				wheel.steer.state = ST_PRE_INITIALIZED;
+			}
+			is_motor_reset = true;
+
+			all_motors_on();
+		}
+		request_status_all(now);
+	}
+
+	void start_network()
+	{
+		can_msg_t msg;
+		msg.id = 0;
+		msg.length = 2;
+		msg.data[0] = 1;		// NMT "start remote node"
+		msg.data[1] = 0;		// all nodes
+		can_transmit(msg);
 	}
 
 	void set_motor_can_id(motor_t& motor, int id)
 	{
 		motor.can_id = id;
+		motor.can_EMCY = id + 0x80;
 		motor.can_Tx_PDO1 = id + 0x180;
-		// motor.can_Rx_PDO1 = id + 0x200;
+		motor.can_Rx_PDO1 = id + 0x200;
 		motor.can_Tx_PDO2 = id + 0x280;
 		motor.can_Rx_PDO2 = id + 0x300;
 		motor.can_Tx_SDO = id + 0x580;
 		motor.can_Rx_SDO = id + 0x600;
+		motor.can_NMT_EC = id + 0x700;
 	}
 
 	void configure_PDO_mapping(const motor_t& motor)
@@ -765,11 +1649,10 @@ private:
 		// stop all emissions of TPDO1
 		canopen_SDO_download(motor, 0x1A00, 0, 0);
 
-		// position 4 byte of TPDO1
-		canopen_SDO_download(motor, 0x1A00, 1, 0x60640020);
-
-		// velocity 4 byte of TPDO1
-		canopen_SDO_download(motor, 0x1A00, 2, 0x60690020);
+		// objects of TPDO1 (default: position and velocity, 4 byte each)
+		for(size_t i = 0; i < m_tpdo1_mapping.size(); ++i) {
+			canopen_SDO_download(motor, 0x1A00, i + 1, m_tpdo1_mapping[i]);
+		}
 
 		can_sync();
 
@@ -777,9 +1660,40 @@ private:
 		canopen_SDO_download(motor, 0x1800, 2, 1);
 
 		// activate mapped objects
-		canopen_SDO_download(motor, 0x1A00, 0, 2);
+		canopen_SDO_download(motor, 0x1A00, 0, m_tpdo1_mapping.size());
 
 		can_sync();
+
+		if(m_rpdo_setpoints)
+		{
+			// disable RPDO1 mapping
+			canopen_SDO_download(motor, 0x1600, 0, 0, 1);
+
+			// skip setpoints of other motors in shared frame (dummy UNSIGNED32 entries)
+			int num_entries = 0;
+			for(int i = 0; i < motor.setpoint_slot; ++i) {
+				canopen_SDO_download(motor, 0x1600, ++num_entries, 0x00070020);
+			}
+
+			// target velocity 4 byte of RPDO1
+			canopen_SDO_download(motor, 0x1600, ++num_entries, 0x60FF0020);
+
+			can_sync();
+
+			// COB-ID of RPDO1 (need to disable first)
+			const int cob_id = m_shared_setpoints ? m_shared_rpdo_id : motor.can_Rx_PDO1;
+			canopen_SDO_download(motor, 0x1400, 1, 0x80000000 | cob_id);
+			canopen_SDO_download(motor, 0x1400, 1, cob_id);
+
+			// transmission type "synch" (apply on next SYNC), or "asynch" (apply on receipt) in phase aligned mode,
+			// since there setpoints are computed after the SYNC and would otherwise be delayed by a full cycle
+			canopen_SDO_download(motor, 0x1400, 2, m_phase_aligned_control ? 255 : 1, 1);
+
+			// activate mapped objects
+			canopen_SDO_download(motor, 0x1600, 0, num_entries, 1);
+
+			can_sync();
+		}
 	}
 
 	void configure_watchdog(const motor_t& motor)
@@ -807,6 +1721,14 @@ private:
 		can_sync();
 	}
 
+	void configure_heartbeat(motor_t& motor)
+	{
+		// producer heartbeat time
+		canopen_SDO_download(motor, 0x1017, 0, m_motor_heartbeat_ms, 2);
+
+		motor.heartbeat_recv_time = get_steady_time();		// timeout starts now
+	}
+
 	void disable_watchdog(const motor_t& motor)
 	{
 		// Motor action after Hearbeat-Error: No Action
@@ -819,10 +1741,11 @@ private:
 		// Object 0x2F21 = "Emergency Events" which cause an Emergency Message
 		// Bit 3 is responsible for Heartbeart-Failure.
 		canopen_SDO_download(motor, 0x2F21, 0, 0x00);
-
-		can_sync();
 	}
 
+	/*
+	 * Queues the SDO writes for all motors first, then waits only once.
+	 */
 	void disable_watchdog_all()
 	{
 		for(auto& wheel : m_wheels)
@@ -833,43 +1756,37 @@ private:
 		can_sync();
 	}
 
-	void set_motor_modulo(const motor_t& motor, int32_t num_wheel_rev)
+	void set_motor_modulo(motor_t& motor, int32_t num_wheel_rev)
 	{
 		const int32_t ticks_per_rev = motor.enc_ticks_per_rev * motor.gear_ratio;
 		canopen_set_int(motor, 'X', 'M', 1, -1 * num_wheel_rev * ticks_per_rev);
 		canopen_set_int(motor, 'X', 'M', 2, num_wheel_rev * ticks_per_rev);
+		motor.enc_modulo_inc = 2 * num_wheel_rev * ticks_per_rev;
 
 		can_sync();
 	}
 
-	void reset_pos_counter(const motor_t& motor)
+	void reset_pos_counter(motor_t& motor)
 	{
 		canopen_set_int(motor, 'P', 'X', 0, 0);
+		motor.rx.modify([](motor_rx_t& rx) {
+			rx.has_enc_pos = false;		// position jumps, do not unwrap
+		});
 	}
 
-	void request_status(motor_t& motor)
+	void request_status(motor_t& motor, steady_time_t now)
 	{
 		canopen_query(motor, 'S', 'R', 0);
-		motor.request_send_time = ros::Time::now();
+		motor.request_send_time = now;
 	}
 
-	void request_status_all()
+	void request_status_all(steady_time_t now)
 	{
-		if(m_motor_group_id >= 0)
-		{
-			canopen_query(m_motor_group_id, 'S', 'R', 0);
+		group_query(GROUP_ALL, 'S', 'R', 0);
 
-			for(auto& wheel : m_wheels) {
-				wheel.drive.request_send_time = ros::Time::now();
-				wheel.steer.request_send_time = ros::Time::now();
-			}
-		}
-		else {
-			for(auto& wheel : m_wheels) {
-				request_status(wheel.drive);
-				request_status(wheel.steer);
-			}
-			can_sync();
+		for(auto& wheel : m_wheels) {
+			wheel.drive.request_send_time = now;
+			wheel.steer.request_send_time = now;
 		}
 	}
 
@@ -886,35 +1803,16 @@ private:
 
 	void all_motors_on()
 	{
-		if(m_motor_group_id >= 0) {
-			canopen_set_int(m_motor_group_id, 'M', 'O', 0, 1);
-		}
-		else {
-			for(auto& wheel : m_wheels) {
-				motor_on(wheel.drive);
-				motor_on(wheel.steer);
-			}
-			can_sync();
-		}
+		group_set_int(GROUP_ALL, 'M', 'O', 0, 1);
 	}
 
 	void all_motors_off()
 	{
-		if(m_motor_group_id >= 0)
-		{
-			canopen_set_int(m_motor_group_id, 'M', 'O', 0, 0);
+		group_set_int(GROUP_ALL, 'M', 'O', 0, 0);
 
-			for(auto& wheel : m_wheels) {
-				wheel.drive.state = ST_PRE_INITIALIZED;
-				wheel.steer.state = ST_PRE_INITIALIZED;
-			}
-		}
-		else {
-			for(auto& wheel : m_wheels) {
-				motor_off(wheel.drive);
-				motor_off(wheel.steer);
-			}
-			can_sync();
+		for(auto& wheel : m_wheels) {
+			wheel.drive.state = ST_PRE_INITIALIZED;
+			wheel.steer.state = ST_PRE_INITIALIZED;
 		}
 		is_motor_reset = true;
 	}
@@ -933,6 +1831,11 @@ private:
 		// set maximum decceleration to X Incr/s^2
 		canopen_set_int(motor, 'D', 'C', 0, motor.max_accel_enc_s);
 
+		// modes of operation: "profile velocity" (target velocity via RPDO1), not yet verified together with UM=2 on hardware
+		if(m_rpdo_setpoints && m_set_mode_of_operation) {
+			canopen_SDO_download(motor, 0x6060, 0, 3, 1);
+		}
+
 		can_sync();
 	}
 
@@ -956,38 +1859,97 @@ private:
 		can_sync();
 	}
 
-	void begin_motion()
+	void begin_motion(motor_group_e group = GROUP_ALL)
 	{
-		if(m_motor_group_id >= 0) {
-			canopen_query(m_motor_group_id, 'B', 'G', 0);
-		}
-		else {
-			for(const auto& wheel : m_wheels)
-			{
-				canopen_query(wheel.drive, 'B', 'G', 0);
-				canopen_query(wheel.steer, 'B', 'G', 0);
-			}
-			can_sync();
+		if(m_rpdo_setpoints) {
+			return;			// RPDO setpoints are applied on next SYNC
 		}
+		group_query(group, 'B', 'G', 0);
 	}
 
 	void stop_motion(const motor_t& motor)
 	{
 		canopen_query(motor, 'S', 'T', 0);
+
+		if(m_rpdo_setpoints) {
+			motor_set_vel(motor, 0);		// otherwise last RPDO setpoint is applied again on next SYNC
+		}
 	}
 
 	void stop_motion()
 	{
-		if(m_motor_group_id >= 0) {
-			canopen_query(m_motor_group_id, 'S', 'T', 0);
-		}
-		else {
+		group_query(GROUP_ALL, 'S', 'T', 0);
+
+		if(m_rpdo_setpoints) {
 			for(const auto& wheel : m_wheels)
 			{
-				stop_motion(wheel.drive);
-				stop_motion(wheel.steer);
+				motor_set_vel(wheel.drive, 0);
+				motor_set_vel(wheel.steer, 0);
+			}
+		}
+	}
+
+	/*
+	 * Returns COB-IDs to address a group of motors, false if they need to be addressed individually.
+	 */
+	bool get_group_ids(motor_group_e group, int (&ids)[2], int& num_ids) const
+	{
+		num_ids = 0;
+		if(group == GROUP_ALL && m_motor_group_id >= 0) {
+			ids[num_ids++] = m_motor_group_id;
+		}
+		else if(group == GROUP_ALL && m_drive_group_id >= 0 && m_steer_group_id >= 0) {
+			ids[num_ids++] = m_drive_group_id;
+			ids[num_ids++] = m_steer_group_id;
+		}
+		else if(group == GROUP_DRIVE && m_drive_group_id >= 0) {
+			ids[num_ids++] = m_drive_group_id;
+		}
+		else if(group == GROUP_STEER && m_steer_group_id >= 0) {
+			ids[num_ids++] = m_steer_group_id;
+		}
+		return num_ids > 0;
+	}
+
+	void group_query(motor_group_e group, char cmd_char_1, char cmd_char_2, int32_t index)
+	{
+		int ids[2];
+		int num_ids = 0;
+		if(get_group_ids(group, ids, num_ids)) {
+			for(int i = 0; i < num_ids; ++i) {
+				canopen_query(ids[i], cmd_char_1, cmd_char_2, index);
+			}
+			return;
+		}
+		for(const auto& wheel : m_wheels)
+		{
+			if(group != GROUP_STEER) {
+				canopen_query(wheel.drive, cmd_char_1, cmd_char_2, index);
+			}
+			if(group != GROUP_DRIVE) {
+				canopen_query(wheel.steer, cmd_char_1, cmd_char_2, index);
+			}
+		}
+	}
+
+	void group_set_int(motor_group_e group, char cmd_char_1, char cmd_char_2, int32_t index, int32_t data)
+	{
+		int ids[2];
+		int num_ids = 0;
+		if(get_group_ids(group, ids, num_ids)) {
+			for(int i = 0; i < num_ids; ++i) {
+				canopen_set_int(ids[i], cmd_char_1, cmd_char_2, index, data);
+			}
+			return;
+		}
+		for(const auto& wheel : m_wheels)
+		{
+			if(group != GROUP_STEER) {
+				canopen_set_int(wheel.drive, cmd_char_1, cmd_char_2, index, data);
+			}
+			if(group != GROUP_DRIVE) {
+				canopen_set_int(wheel.steer, cmd_char_1, cmd_char_2, index, data);
 			}
-			can_sync();
 		}
 	}
 
@@ -997,7 +1959,49 @@ private:
 		const int32_t motor_vel_inc_s = motor.rot_sign * int(motor_vel_rev_s * motor.enc_ticks_per_rev);
 		const int32_t lim_motor_vel_inc_s = std::min(std::max(motor_vel_inc_s, -motor.max_vel_enc_s), motor.max_vel_enc_s);
 
-		canopen_set_int(motor, 'J', 'V', 0, lim_motor_vel_inc_s);
+		if(m_shared_setpoints)
+		{
+			auto& bus = *m_buses[motor.bus];
+			bus.setpoints[motor.setpoint_slot] = lim_motor_vel_inc_s;
+			bus.has_setpoints = true;		// sent by send_shared_setpoints()
+		}
+		else if(m_rpdo_setpoints)
+		{
+			can_msg_t msg;
+			msg.bus = motor.bus;
+			msg.id = motor.can_Rx_PDO1;
+			msg.length = 4;
+			msg.data[0] = lim_motor_vel_inc_s;
+			msg.data[1] = lim_motor_vel_inc_s >> 8;
+			msg.data[2] = lim_motor_vel_inc_s >> 16;
+			msg.data[3] = lim_motor_vel_inc_s >> 24;
+			can_transmit(msg);
+		}
+		else {
+			canopen_set_int(motor, 'J', 'V', 0, lim_motor_vel_inc_s);
+		}
+	}
+
+	/*
+	 * Sends one frame per bus with the setpoints of all motors on it.
+	 */
+	void send_shared_setpoints()
+	{
+		for(auto& bus : m_buses)
+		{
+			if(!bus->has_setpoints) {
+				continue;
+			}
+			can_msg_t msg;
+			msg.bus = bus->index;
+			msg.id = m_shared_rpdo_id;
+			msg.length = 4 * bus->setpoints.size();
+			for(size_t i = 0; i < bus->setpoints.size(); ++i) {
+				::memcpy(msg.data + 4 * i, &bus->setpoints[i], 4);
+			}
+			can_transmit(msg);
+			bus->has_setpoints = false;
+		}
 	}
 
 	void motor_set_pos_abs(const motor_t& motor, double angle_rad)
@@ -1010,12 +2014,13 @@ private:
 
 	void canopen_query(const motor_t& motor, char cmd_char_1, char cmd_char_2, int32_t index)
 	{
-		canopen_query(motor.can_Rx_PDO2, cmd_char_1, cmd_char_2, index);
+		canopen_query(motor.can_Rx_PDO2, cmd_char_1, cmd_char_2, index, motor.bus);
 	}
 
-	void canopen_query(int id, char cmd_char_1, char cmd_char_2, int32_t index)
+	void canopen_query(int id, char cmd_char_1, char cmd_char_2, int32_t index, int bus = -1)
 	{
 		can_msg_t msg;
+		msg.bus = bus;
 		msg.id = id;
 		msg.length = 4;
 		msg.data[0] = cmd_char_1;
@@ -1027,12 +2032,13 @@ private:
 
 	void canopen_set_int(const motor_t& motor, char cmd_char_1, char cmd_char_2, int32_t index, int32_t data)
 	{
-		canopen_set_int(motor.can_Rx_PDO2, cmd_char_1, cmd_char_2, index, data);
+		canopen_set_int(motor.can_Rx_PDO2, cmd_char_1, cmd_char_2, index, data, motor.bus);
 	}
 
-	void canopen_set_int(int id, char cmd_char_1, char cmd_char_2, int32_t index, int32_t data)
+	void canopen_set_int(int id, char cmd_char_1, char cmd_char_2, int32_t index, int32_t data, int bus = -1)
 	{
 		can_msg_t msg;
+		msg.bus = bus;
 		msg.id = id;
 		msg.length = 8;
 		msg.data[0] = cmd_char_1;
@@ -1046,14 +2052,15 @@ private:
 		can_transmit(msg);
 	}
 
-	void canopen_SDO_download(const motor_t& motor, int32_t obj_index, int32_t obj_sub_index, int32_t data)
+	void canopen_SDO_download(const motor_t& motor, int32_t obj_index, int32_t obj_sub_index, int32_t data, int num_bytes = 4)
 	{
 		const int32_t ciInitDownloadReq = 0x20;
-		const int32_t ciNrBytesNoData = 0x00;
+		const int32_t ciNrBytesNoData = 4 - num_bytes;
 		const int32_t ciExpedited = 0x02;
 		const int32_t ciDataSizeInd = 0x01;
 
 		can_msg_t msg;
+		msg.bus = motor.bus;
 		msg.id = motor.can_Rx_SDO;
 		msg.length = 8;
 		msg.data[0] = ciInitDownloadReq | (ciNrBytesNoData << 2) | ciExpedited | ciDataSizeInd;
@@ -1067,151 +2074,588 @@ private:
 		can_transmit(msg);
 	}
 
-	void can_transmit(const can_msg_t& msg)
+	/*
+	 * Sends a message right away if possible, otherwise adds it to the transmit queue.
+	 */
+	void can_transmit(const can_msg_t& msg)
+	{
+		if(msg.bus < 0) {
+			for(auto& bus : m_buses) {
+				can_transmit(*bus, msg);		// broadcast on all buses
+			}
+		}
+		else {
+			can_transmit(*m_buses.at(msg.bus), msg);
+		}
+	}
+
+	void can_transmit(can_bus_t& bus, const can_msg_t& msg)
+	{
+		// wait for socket to be ready for writing (queue messages while recovering)
+		if(m_wait_for_can_sock && !bus.is_recovering) {
+			std::unique_lock<std::mutex> lock(bus.mutex);
+			while(do_run && bus.sock < 0) {
+				bus.condition.wait(lock);
+			}
+		}
+		if(!do_run) {
+			throw std::runtime_error("shutdown");
+		}
+
+		std::lock_guard<std::mutex> lock(bus.tx_mutex);
+
+		// keep order, only send directly if nothing is queued
+		if(bus.tx_queue.empty() && can_write(bus, msg)) {
+			return;
+		}
+		uint64_t key = 0;
+		const auto priority = get_tx_priority(msg, key);
+
+		if(!bus.tx_queue.push(msg, priority, key)) {
+			ROS_WARN_STREAM_THROTTLE(1, "CAN transmit queue full on '" << bus.iface << "', dropping messages!");
+		}
+		can_flush_queue(bus, std::chrono::steady_clock::now());
+	}
+
+	/*
+	 * Waits up to timeout seconds for the transmit queues to be sent.
+	 */
+	void can_flush(double timeout)
+	{
+		const auto deadline = std::chrono::steady_clock::now()
+				+ std::chrono::microseconds(int64_t(timeout * 1e6));
+
+		for(auto& bus : m_buses)
+		{
+			std::lock_guard<std::mutex> lock(bus->tx_mutex);
+			can_flush_queue(*bus, deadline);
+		}
+	}
+
+	/*
+	 * Assumes bus.tx_mutex is locked.
+	 */
+	void can_flush_queue(can_bus_t& bus, std::chrono::steady_clock::time_point deadline)
+	{
+		if(bus.sock < 0) {
+			return;
+		}
+		while(!bus.tx_queue.empty())
+		{
+			if(can_write(bus, bus.tx_queue.front())) {
+				bus.tx_queue.pop();
+				continue;
+			}
+			const int error = errno;
+			if(error != EAGAIN && error != EWOULDBLOCK && error != ENOBUFS) {
+				break;			// socket error, handled by receive_loop()
+			}
+			const auto wait_us = std::chrono::duration_cast<std::chrono::microseconds>(
+					deadline - std::chrono::steady_clock::now()).count();
+			if(wait_us <= 0) {
+				break;
+			}
+			if(error == ENOBUFS) {
+				// device queue full, poll() does not tell us when there is space again
+				::usleep(std::min<int64_t>(wait_us, 200));
+			}
+			else {
+				::pollfd pfd = {};
+				pfd.fd = bus.sock;
+				pfd.events = POLLOUT;
+				if(::poll(&pfd, 1, std::max<int>(wait_us / 1000, 1)) <= 0) {
+					break;
+				}
+			}
+		}
+	}
+
+	/*
+	 * Tries to send a message without blocking.
+	 *
+	 * @return false if it needs to be queued.
+	 */
+	bool can_write(can_bus_t& bus, const can_msg_t& msg)
+	{
+		if(bus.sock < 0) {
+			return false;
+		}
+		if(msg.length > 8)
+		{
+			::canfd_frame out = {};
+			out.can_id = msg.id;
+			out.len = get_fd_length(msg.length);
+			out.flags = m_can_fd_brs ? CANFD_BRS : 0;
+			::memcpy(out.data, msg.data, msg.length);
+
+			const auto res = ::send(bus.sock, &out, sizeof(out), MSG_DONTWAIT);
+			if(res == sizeof(out)) {
+				bus.tx_load.add(out.can_id, out.len, out.data, out.flags & CANFD_BRS);
+				return true;
+			}
+		}
+		else
+		{
+			::can_frame out = {};
+			out.can_id = msg.id;
+			out.can_dlc = msg.length;
+			::memcpy(out.data, msg.data, msg.length);
+
+			const auto res = ::send(bus.sock, &out, sizeof(out), MSG_DONTWAIT);
+			if(res == sizeof(out)) {
+				bus.tx_load.add(out.can_id, out.can_dlc, out.data);
+				return true;
+			}
+		}
+		if(errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+			ROS_WARN_STREAM_THROTTLE(1, "send() failed with: " << ::strerror(errno));
+		}
+		return false;
+	}
+
+	/*
+	 * Returns next valid CAN FD frame length.
+	 */
+	static int get_fd_length(int length)
+	{
+		for(const int valid : {8, 12, 16, 20, 24, 32, 48, 64}) {
+			if(length <= valid) {
+				return valid;
+			}
+		}
+		throw std::logic_error("CAN FD frame too long");
+	}
+
+	/*
+	 * Returns transmit priority of a message, as well as a key to coalesce it with older ones (0 = none).
+	 * Only periodic messages (SYNC, heartbeat, JV / PA setpoints, RPDO1) may overtake or replace queued ones,
+	 * everything else keeps its order, since command sequences (ie. HM config, arm, BG) depend on it.
+	 */
+	tx_queue_t::priority_e get_tx_priority(const can_msg_t& msg, uint64_t& key) const
+	{
+		key = 0;
+		if(msg.id == 0x80 || msg.id == 0x700) {
+			key = msg.id;
+			return tx_queue_t::PRIO_PERIODIC;
+		}
+		if(msg.id >= 0x200 && msg.id < 0x280) {
+			key = msg.id;
+			return tx_queue_t::PRIO_PERIODIC;
+		}
+		if(msg.id >= 0x300 && msg.id < 0x380 && msg.length > 4)
+		{
+			if((msg.data[0] == 'J' && msg.data[1] == 'V')
+				|| (msg.data[0] == 'P' && msg.data[1] == 'A'))
+			{
+				key = (uint64_t(msg.id) << 32) | (msg.data[0] << 24) | (msg.data[1] << 16) | (msg.data[3] << 8) | msg.data[2];
+				return tx_queue_t::PRIO_PERIODIC;
+			}
+		}
+		return tx_queue_t::PRIO_COMMAND;
+	}
+
+	/*
+	 * Sends a SYNC, which triggers TPDO1 of all motors and applies synchronous RPDO1 setpoints.
+	 */
+	void send_sync()
+	{
+		// update sync time first, replies may be processed by receive_loop() before can_transmit() returns
+		const steady_time_t sync_time = get_steady_time();
+		m_last_sync_stamp_ns = get_ros_time(sync_time).toNSec();
+		m_last_sync_time = sync_time;
+		m_sync_counter++;
+
+		can_msg_t msg;
+		msg.id  = 0x80;
+		msg.length = 0;
+		can_transmit(msg);
+	}
+
+	/*
+	 * Converts steady time to ROS time, for message stamps only.
+	 */
+	ros::Time get_ros_time(steady_time_t time) const
+	{
+		return ros::Time(m_clock_map.convert(time));
+	}
+
+	/*
+	 * Waits till all msgs are sent on the bus.
+	 */
+	void can_sync()
+	{
+		can_flush(0.01);
+		::usleep(10000);		// workaround, sleep for around 10 msgs
+
+		process_mailboxes();	// handle replies received in the meantime
+	}
+
+	/*
+	 * Processes incoming CAN msgs, except for measured values.
+	 * Called via process_msg() only, with m_node_mutex locked.
+	 */
+	void handle(const can_msg_t& msg)
+	{
+		for(auto& wheel : m_wheels)
+		{
+			if(msg.bus == wheel.drive.bus && msg.id == wheel.drive.can_EMCY) {
+				handle_EMCY(wheel.drive, msg);
+			}
+			if(msg.bus == wheel.steer.bus && msg.id == wheel.steer.can_EMCY) {
+				handle_EMCY(wheel.steer, msg);
+			}
+			if(msg.bus == wheel.drive.bus && msg.id == wheel.drive.can_NMT_EC) {
+				handle_heartbeat(wheel.drive, msg);
+			}
+			if(msg.bus == wheel.steer.bus && msg.id == wheel.steer.can_NMT_EC) {
+				handle_heartbeat(wheel.steer, msg);
+			}
+			// measured values are already decoded by receive_loop(), we only need to check the status word
+			if(msg.bus == wheel.drive.bus && msg.id == wheel.drive.can_Tx_PDO1) {
+				evaluate_status_word(wheel.drive, wheel.drive.rx.load().curr_status_word);
+			}
+			if(msg.bus == wheel.steer.bus && msg.id == wheel.steer.can_Tx_PDO1) {
+				evaluate_status_word(wheel.steer, wheel.steer.rx.load().curr_status_word);
+			}
+			if(msg.bus == wheel.drive.bus && msg.id == wheel.drive.can_Tx_PDO2) {
+				handle_PDO2(wheel.drive, msg);
+			}
+			if(msg.bus == wheel.steer.bus && msg.id == wheel.steer.can_Tx_PDO2) {
+				handle_PDO2(wheel.steer, msg);
+			}
+		}
+	}
+
+	/*
+	 * Processes a msg by handle(), if m_node_mutex is available right away, otherwise queues it for later.
+	 * Called by receive_loop() only, so it never waits for the control thread.
+	 */
+	void process_event(can_bus_t& bus, const can_msg_t& msg)
+	{
+		std::unique_lock<std::mutex> lock(m_node_mutex, std::try_to_lock);
+		if(!lock.owns_lock())
+		{
+			if(bus.rx_mailbox.push(msg)) {
+				::sem_post(&m_mailbox_sem);		// wake up mailbox_loop()
+			} else {
+				ROS_WARN_STREAM_THROTTLE(1, "Receive mailbox for '" << bus.iface << "' is full, dropped "
+						<< bus.rx_mailbox.get_num_dropped() << " msgs so far.");
+			}
+			return;
+		}
+		m_wait_for_can_sock = false;		// disable waiting for transmit (avoid dead-lock)
+
+		process_mailbox(bus);				// keep order of msgs
+		process_msg(msg);
+
+		m_wait_for_can_sock = true;			// enable waiting again
+	}
+
+	/*
+	 * Handles msgs queued by process_event(), assumes m_node_mutex is locked.
+	 */
+	void process_mailbox(can_bus_t& bus)
+	{
+		can_msg_t msg;
+		while(bus.rx_mailbox.pop(msg)) {
+			process_msg(msg);
+		}
+	}
+
+	void process_mailboxes()
+	{
+		for(auto& bus : m_buses) {
+			process_mailbox(*bus);
+		}
+	}
+
+	/*
+	 * Handles mailbox msgs (ie. EMCY) right after m_node_mutex is released, instead of waiting for the next update().
+	 */
+	void mailbox_loop()
+	{
+		while(do_run)
+		{
+			if(::sem_wait(&m_mailbox_sem) < 0) {
+				continue;			// interrupted
+			}
+			std::lock_guard<std::mutex> lock(m_node_mutex);
+			process_mailboxes();
+		}
+	}
+
+	void process_msg(const can_msg_t& msg)
+	{
+		try {
+			handle(msg);
+		}
+		catch(const std::exception& ex) {
+			ROS_WARN_STREAM(ex.what());
+		}
+	}
+
+	/*
+	 * Returns motor which sent given TPDO1 msg, nullptr otherwise.
+	 */
+	motor_t* find_PDO1_motor(const can_msg_t& msg)
+	{
+		for(auto& wheel : m_wheels)
+		{
+			if(msg.bus == wheel.drive.bus && msg.id == wheel.drive.can_Tx_PDO1) {
+				return &wheel.drive;
+			}
+			if(msg.bus == wheel.steer.bus && msg.id == wheel.steer.can_Tx_PDO1) {
+				return &wheel.steer;
+			}
+		}
+		return nullptr;
+	}
+
+	/*
+	 * Checks if all enabled motors sent their values for the last SYNC, if so publishes them.
+	 * Called by receive_loop() only, without locking m_node_mutex.
+	 */
+	void check_update_done(can_bus_t& bus, steady_time_t now)
 	{
-		::can_frame out = {};
-		out.can_id = msg.id;
-		out.can_dlc = msg.length;
-		for(int i = 0; i < msg.length; ++i) {
-			out.data[i] = msg.data[i];
+		const steady_time_t sync_time = m_last_sync_time;
+		steady_time_t last_update_time = m_last_update_time;
+		if(last_update_time >= sync_time) {
+			return;			// already done
 		}
+		const uint32_t enabled_mask = m_enabled_mask;
+		auto& snapshot = bus.rx_snapshot;
+
+		int num_motor_updates = 0;
+		int num_motors_required = 0;
+		for(int i = 0; i < m_num_wheels; ++i)
+		{
+			snapshot[2 * i] = m_wheels[i].drive.rx.load();
+			snapshot[2 * i + 1] = m_wheels[i].steer.rx.load();
 
-		// wait for socket to be ready for writing
-		if(m_wait_for_can_sock) {
-			std::unique_lock<std::mutex> lock(m_can_mutex);
-			while(do_run && m_can_sock < 0) {
-				m_can_condition.wait(lock);
+			if((enabled_mask >> i) & 1) {
+				num_motors_required += 2;
+				num_motor_updates += snapshot[2 * i].update_recv_time > sync_time ? 1 : 0;
+				num_motor_updates += snapshot[2 * i + 1].update_recv_time > sync_time ? 1 : 0;
 			}
 		}
-		if(!do_run) {
-			throw std::runtime_error("shutdown");
+		if(num_motor_updates < num_motors_required) {
+			return;
+		}
+		if(!m_last_update_time.compare_exchange_strong(last_update_time, now)) {
+			return;			// done by other bus
 		}
 
-		// send msg
+		if(m_num_sub_joint_state > 0 || m_num_sub_joint_state_raw > 0)
+		{
+			ros::Time timestamp;
+			timestamp.fromNSec(m_last_sync_stamp_ns);
+			push_joint_sample(bus, timestamp + ros::Duration(m_motor_delay), snapshot, enabled_mask);
+		}
+		if(m_phase_aligned_control)
 		{
-			const auto res = ::write(m_can_sock, &out, sizeof(out));
-			if(res < 0) {
-				throw std::runtime_error("write() failed with: " + std::string(strerror(errno)));
-			}
-			if(res != sizeof(out))
 			{
-				// re-open socket
-				::shutdown(m_can_sock, SHUT_RDWR);
-				throw std::logic_error("write() buffer overflow!");
+				std::lock_guard<std::mutex> lock(m_update_mutex);		// avoid lost wake-up
 			}
+			m_update_condition.notify_all();
 		}
 	}
 
 	/*
-	 * Waits till all msgs are sent on the bus.
+	 * Computes wheel values from the latest measured motor values, called by update().
 	 */
-	void can_sync()
+	void update_wheel_states()
 	{
-		::usleep(10000);		// workaround, sleep for around 10 msgs
+		for(auto& wheel : m_wheels)
+		{
+			const motor_rx_t drive = wheel.drive.rx.load();
+			const motor_rx_t steer = wheel.steer.rx.load();
+
+			wheel.curr_wheel_pos = m_travel_odometry ? calc_wheel_travel(wheel.drive, drive) : calc_wheel_pos(wheel.drive, drive);
+			wheel.curr_wheel_vel = calc_wheel_vel(wheel.drive, drive);
+			wheel.curr_steer_pos = calc_wheel_pos(wheel.steer, steer);
+			wheel.curr_steer_vel = calc_wheel_vel(wheel.steer, steer);
+		}
 	}
 
 	/*
-	 * Processes incoming CAN msgs.
-	 * Called by receive_loop() only!
+	 * Updates m_enabled_mask, needs to be called after changing module_t::is_enabled.
 	 */
-	void handle(const can_msg_t& msg)
+	void update_enabled_mask()
 	{
-		size_t num_motor_updates = 0;
+		uint32_t mask = 0;
+		for(int i = 0; i < m_num_wheels; ++i) {
+			if(m_wheels[i].is_enabled) {
+				mask |= uint32_t(1) << i;
+			}
+		}
+		m_enabled_mask = mask;
+	}
 
-		for(auto& wheel : m_wheels)
+	/*
+	 * Copies given joint values into the queue for publish_loop(), without allocating or locking.
+	 * Called by the receive_loop() of given bus only, each bus has its own queue.
+	 */
+	void push_joint_sample(can_bus_t& bus, ros::Time timestamp, const std::vector<motor_rx_t>& snapshot, uint32_t enabled_mask)
+	{
+		auto& sample = bus.joint_sample;
+		sample.stamp = timestamp;
+		sample.has_joint_state = m_num_sub_joint_state > 0;
+		sample.has_joint_state_raw = m_num_sub_joint_state_raw > 0;
+
+		for(int i = 0; i < m_num_wheels; ++i)
 		{
-			if(msg.id == wheel.drive.can_Tx_PDO1) {
-				handle_PDO1(wheel.drive, msg);
-			}
-			if(msg.id == wheel.steer.can_Tx_PDO1) {
-				handle_PDO1(wheel.steer, msg);
-			}
-			if(msg.id == wheel.drive.can_Tx_PDO2) {
-				handle_PDO2(wheel.drive, msg);
-			}
-			if(msg.id == wheel.steer.can_Tx_PDO2) {
-				handle_PDO2(wheel.steer, msg);
-			}
+			const auto& wheel = m_wheels[i];
+			const auto& drive = snapshot[2 * i];
+			const auto& steer = snapshot[2 * i + 1];
+			auto& out = sample.wheels[i];
+			out.is_enabled = (enabled_mask >> i) & 1;
+			out.wheel_pos = m_travel_odometry ? calc_wheel_travel(wheel.drive, drive) : calc_wheel_pos(wheel.drive, drive);
+			out.wheel_vel = calc_wheel_vel(wheel.drive, drive);
+			out.steer_pos = calc_wheel_pos(wheel.steer, steer) + wheel.home_angle;
+			out.steer_vel = calc_wheel_vel(wheel.steer, steer);
+			out.drive_torque = drive.curr_torque;
+			out.steer_torque = steer.curr_torque;
+			out.drive_enc_pos = drive.curr_enc_pos_inc;
+			out.drive_enc_vel = drive.curr_enc_vel_inc_s;
+			out.steer_enc_pos = steer.curr_enc_pos_inc;
+			out.steer_enc_vel = steer.curr_enc_vel_inc_s;
+		}
+
+		if(bus.joint_queue->push(sample)) {
+			::sem_post(&m_publish_sem);
+		} else {
+			ROS_WARN_STREAM_THROTTLE(10, "Joint state publishing is falling behind, dropped "
+					<< bus.joint_queue->get_num_dropped() << " samples so far.");
+		}
+	}
 
-			// re-compute wheel values
-			if(wheel.drive.update_recv_time > m_last_sync_time)
-			{
-				wheel.curr_wheel_pos = calc_wheel_pos(wheel.drive);
-				wheel.curr_wheel_vel = calc_wheel_vel(wheel.drive);
-				num_motor_updates++;
-			}
-			if(wheel.steer.update_recv_time > m_last_sync_time)
-			{
-				wheel.curr_steer_pos = calc_wheel_pos(wheel.steer);
-				wheel.curr_steer_vel = calc_wheel_vel(wheel.steer);
-				num_motor_updates++;
-			}
+	/*
+	 * Builds and publishes JointState messages from the samples queued by push_joint_sample().
+	 */
+	void publish_loop()
+	{
+		// next sample of each bus, to publish in time order
+		std::vector<joint_sample_t> pending(m_buses.size());
+		std::vector<bool> has_pending(m_buses.size());
+		for(auto& sample : pending) {
+			sample.wheels.resize(m_num_wheels);
 		}
 
-		// check if we have all data for next update
-		if(num_motor_updates >= m_wheels.size() * 2 && m_last_update_time < m_last_sync_time)
+		while(do_run)
 		{
-			const ros::Time now = ros::Time::now();
-			const ros::Time timestamp = m_last_sync_time + ros::Duration(m_motor_delay);
-			publish_joint_states(timestamp);
-			publish_joint_states_raw(timestamp);
-			m_last_update_time = now;
+			if(::sem_wait(&m_publish_sem) < 0) {
+				continue;			// interrupted
+			}
+			while(true)
+			{
+				int next = -1;
+				for(size_t i = 0; i < m_buses.size(); ++i)
+				{
+					if(!has_pending[i]) {
+						has_pending[i] = m_buses[i]->joint_queue->pop(pending[i]);
+					}
+					if(has_pending[i] && (next < 0 || pending[i].stamp < pending[next].stamp)) {
+						next = i;
+					}
+				}
+				if(next < 0) {
+					break;
+				}
+				const auto& sample = pending[next];
+				if(sample.has_joint_state) {
+					publish_joint_states(sample);
+				}
+				if(sample.has_joint_state_raw) {
+					publish_joint_states_raw(sample);
+				}
+				has_pending[next] = false;
+			}
 		}
 	}
 
-	void publish_joint_states(ros::Time timestamp)
+	/*
+	 * Called by publish_loop() only. Joint names are not modified after construction.
+	 */
+	void publish_joint_states(const joint_sample_t& sample)
 	{
 		sensor_msgs::JointState::Ptr joint_state = boost::make_shared<sensor_msgs::JointState>();
-		joint_state->header.stamp = timestamp;
+		joint_state->header.stamp = sample.stamp;
 
-		for(auto& wheel : m_wheels)
+		for(int i = 0; i < m_num_wheels; ++i)
 		{
-			joint_state->name.push_back(wheel.drive.joint_name);
-			joint_state->name.push_back(wheel.steer.joint_name);
-			joint_state->position.push_back(wheel.curr_wheel_pos);
-			joint_state->position.push_back(wheel.curr_steer_pos + wheel.home_angle);
-			joint_state->velocity.push_back(wheel.curr_wheel_vel);
-			joint_state->velocity.push_back(wheel.curr_steer_vel);
-			joint_state->effort.push_back(wheel.drive.curr_torque);
-			joint_state->effort.push_back(wheel.steer.curr_torque);
+			const auto& wheel = sample.wheels[i];
+			if(!wheel.is_enabled) {
+				continue;			// tell kinematics to not use this module
+			}
+			joint_state->name.push_back(m_wheels[i].drive.joint_name);
+			joint_state->name.push_back(m_wheels[i].steer.joint_name);
+			joint_state->position.push_back(wheel.wheel_pos);
+			joint_state->position.push_back(wheel.steer_pos);
+			joint_state->velocity.push_back(wheel.wheel_vel);
+			joint_state->velocity.push_back(wheel.steer_vel);
+			joint_state->effort.push_back(wheel.drive_torque);
+			joint_state->effort.push_back(wheel.steer_torque);
 		}
 		m_pub_joint_state.publish(joint_state);
 	}
 
-	void publish_joint_states_raw(ros::Time timestamp)
+	void publish_joint_states_raw(const joint_sample_t& sample)
 	{
 		sensor_msgs::JointState::Ptr joint_state = boost::make_shared<sensor_msgs::JointState>();
-		joint_state->header.stamp = timestamp;
+		joint_state->header.stamp = sample.stamp;
 
-		for(auto& wheel : m_wheels)
+		for(int i = 0; i < m_num_wheels; ++i)
 		{
-			joint_state->name.push_back(wheel.drive.joint_name);
-			joint_state->name.push_back(wheel.steer.joint_name);
-			joint_state->position.push_back(wheel.drive.curr_enc_pos_inc);
-			joint_state->position.push_back(wheel.steer.curr_enc_pos_inc);
-			joint_state->velocity.push_back(wheel.drive.curr_enc_vel_inc_s);
-			joint_state->velocity.push_back(wheel.steer.curr_enc_vel_inc_s);
-			joint_state->effort.push_back(wheel.drive.curr_torque);
-			joint_state->effort.push_back(wheel.steer.curr_torque);
+			const auto& wheel = sample.wheels[i];
+			joint_state->name.push_back(m_wheels[i].drive.joint_name);
+			joint_state->name.push_back(m_wheels[i].steer.joint_name);
+			joint_state->position.push_back(wheel.drive_enc_pos);
+			joint_state->position.push_back(wheel.steer_enc_pos);
+			joint_state->velocity.push_back(wheel.drive_enc_vel);
+			joint_state->velocity.push_back(wheel.steer_enc_vel);
+			joint_state->effort.push_back(wheel.drive_torque);
+			joint_state->effort.push_back(wheel.steer_torque);
 		}
 		m_pub_joint_state_raw.publish(joint_state);
 	}
 
-	double calc_wheel_pos(motor_t& motor) const
+	double calc_wheel_pos(const motor_t& motor, const motor_rx_t& rx) const
+	{
+		return 2 * M_PI * double(motor.rot_sign * rx.curr_enc_pos_inc)
+				/ motor.enc_ticks_per_rev / motor.gear_ratio;
+	}
+
+	double calc_wheel_travel(const motor_t& motor, const motor_rx_t& rx) const
 	{
-		return 2 * M_PI * double(motor.rot_sign * motor.curr_enc_pos_inc)
+		return 2 * M_PI * double(motor.rot_sign * rx.curr_enc_travel_inc)
 				/ motor.enc_ticks_per_rev / motor.gear_ratio;
 	}
 
-	double calc_wheel_vel(motor_t& motor) const
+	double calc_wheel_vel(const motor_t& motor, const motor_rx_t& rx) const
 	{
-		return 2 * M_PI * double(motor.rot_sign * motor.curr_enc_vel_inc_s)
+		return 2 * M_PI * double(motor.rot_sign * rx.curr_enc_vel_inc_s)
 				/ motor.enc_ticks_per_rev / motor.gear_ratio;
 	}
 
+	/*
+	 * Reads a little-endian signed integer of 1 to 4 bytes.
+	 */
+	int32_t read_int(const can_msg_t& msg, int offset, int num_bytes) const
+	{
+		if(offset < 0 || num_bytes < 1 || num_bytes > 4 || offset + num_bytes > int(sizeof(msg.data))) {
+			throw std::logic_error("invalid offset");
+		}
+		uint32_t value = 0;
+		for(int i = num_bytes - 1; i >= 0; --i) {
+			value = (value << 8) | msg.data[offset + i];
+		}
+		const int shift = 32 - 8 * num_bytes;
+		return int32_t(value << shift) >> shift;
+	}
+
 	int32_t read_int32(const can_msg_t& msg, int offset) const
 	{
-		if(offset < 0 || offset > 4) {
+		if(offset < 0 || offset > int(sizeof(msg.data)) - 4) {
 			throw std::logic_error("invalid offset");
 		}
 		int32_t value = 0;
@@ -1229,11 +2673,169 @@ private:
 		return value;
 	}
 
-	void handle_PDO1(motor_t& motor, const can_msg_t& msg)
+	/*
+	 * Computes the shortest encoder position change, taking the modulo of the position counter into account.
+	 */
+	int64_t calc_enc_delta(const motor_t& motor, int32_t prev_pos_inc, int32_t pos_inc) const
+	{
+		if(motor.enc_modulo_inc > 0)
+		{
+			const int64_t modulo = motor.enc_modulo_inc;
+			int64_t delta = (int64_t(pos_inc) - int64_t(prev_pos_inc)) % modulo;
+			if(delta >= modulo / 2) {
+				delta -= modulo;
+			} else if(delta < -modulo / 2) {
+				delta += modulo;
+			}
+			return delta;
+		}
+		return int32_t(uint32_t(pos_inc) - uint32_t(prev_pos_inc));		// int32 overflow
+	}
+
+	/*
+	 * Decodes TPDO1 into motor.rx, called by receive_loop() only, without locking m_node_mutex.
+	 * Returns true if the status word changed, in which case the msg needs to be processed by handle() as well.
+	 */
+	bool handle_PDO1(motor_t& motor, const can_msg_t& msg)
+	{
+		bool is_status_changed = false;
+
+		motor.rx.modify([this, &motor, &msg, &is_status_changed](motor_rx_t& rx)
+		{
+			// decode according to tpdo1_mapping
+			int offset = 0;
+			for(const int entry : m_tpdo1_mapping)
+			{
+				const int num_bytes = (entry & 0xFF) / 8;
+				if(offset + num_bytes > msg.length) {
+					break;
+				}
+				const int32_t value = read_int(msg, offset, num_bytes);
+
+				switch(entry >> 16)
+				{
+					case 0x6064:			// position actual value
+						if(rx.has_enc_pos) {
+							rx.curr_enc_travel_inc += calc_enc_delta(motor, rx.curr_enc_pos_inc, value);
+						}
+						rx.has_enc_pos = true;
+						rx.curr_enc_pos_inc = value;
+						break;
+					case 0x6069:			// velocity sensor actual value
+					case 0x606C:			// velocity actual value
+						rx.curr_enc_vel_inc_s = value;
+						break;
+					case 0x6078:			// current actual value (per thousand of rated current)
+						rx.curr_torque = value * 1e-3 * motor.rated_current * motor.torque_constant;
+						break;
+					case 0x6041:			// status word
+						is_status_changed = rx.curr_status_word != (value & 0xFFFF);
+						rx.curr_status_word = value & 0xFFFF;
+						break;
+					case 0x1001:			// error register
+						rx.curr_error_register = value & 0xFF;
+						break;
+				}
+				offset += num_bytes;
+			}
+			rx.update_recv_time = msg.time;
+		});
+		return is_status_changed;
+	}
+
+	void evaluate_status_word(motor_t& motor, uint16_t status_word)
+	{
+		const uint16_t prev_status_word = motor.curr_status_word;
+		motor.curr_status_word = status_word;
+
+		// check Bit 3 (-> Fault)
+		if(status_word & (1 << 3))
+		{
+			if(!(prev_status_word & (1 << 3))) {
+				ROS_ERROR_STREAM(motor.joint_name << ": drive fault (status word 0x" << std::hex << status_word << std::dec << ")");
+
+				// request detailed description of failure
+				canopen_query(motor, 'M', 'F', 0);
+			}
+			motor.state = ST_MOTOR_FAILURE;
+		}
+	}
+
+	void handle_heartbeat(motor_t& motor, const can_msg_t& msg)
+	{
+		if(msg.length < 1) {
+			return;
+		}
+		const int32_t prev_state = motor.nmt_state;
+		motor.nmt_state = msg.data[0] & 0x7F;
+		motor.heartbeat_recv_time = msg.time;
+
+		if(motor.nmt_state == 0x00)
+		{
+			// boot-up message, drive lost its configuration
+			ROS_ERROR_STREAM(motor.joint_name << ": drive rebooted!");
+			motor.state = ST_MOTOR_FAILURE;
+			m_boot_counter++;
+		}
+		else if(motor.nmt_state == 0x04 || motor.nmt_state == 0x7F)
+		{
+			// no PDO communication in stopped or pre-operational state
+			if(motor.nmt_state != prev_state) {
+				ROS_ERROR_STREAM(motor.joint_name << ": drive left operational state (NMT state 0x"
+						<< std::hex << motor.nmt_state << std::dec << ")");
+			}
+			motor.state = ST_MOTOR_FAILURE;
+		}
+	}
+
+	void handle_EMCY(motor_t& motor, const can_msg_t& msg)
 	{
-		motor.curr_enc_pos_inc = read_int32(msg, 0);
-		motor.curr_enc_vel_inc_s = read_int32(msg, 4);
-		motor.update_recv_time = ros::Time::now();
+		if(msg.length < 3) {
+			return;
+		}
+		const uint16_t prev_code = motor.curr_emcy_code;
+		motor.curr_emcy_code = msg.data[0] | (msg.data[1] << 8);
+		const uint8_t error_register = msg.data[2];
+		motor.rx.modify([error_register](motor_rx_t& rx) {
+			rx.curr_error_register = error_register;
+		});
+
+		if(motor.curr_emcy_code == 0)
+		{
+			// error reset, get new status
+			if(prev_code != 0) {
+				ROS_INFO_STREAM(motor.joint_name << ": emergency cleared");
+			}
+			request_status(motor, msg.time);
+			return;
+		}
+		if(!is_emcy_fault(motor.curr_emcy_code, error_register))
+		{
+			// warning only (ie. CAN overrun), drive keeps running
+			motor.num_emcy_warnings++;
+			ROS_WARN_STREAM(motor.joint_name << ": emergency warning: " << get_emcy_text(motor.curr_emcy_code)
+					<< " (code 0x" << std::hex << motor.curr_emcy_code << ", register 0x" << int(error_register) << std::dec
+					<< ", count " << motor.num_emcy_warnings << ")");
+			return;
+		}
+		evaluate_emergency(motor);
+
+		// stop immediately, instead of waiting for next status update (no can_sync() in receive thread)
+		if(m_degraded_mode) {
+			stop_motion(motor);
+		}
+		else {
+			for(const auto& wheel : m_wheels)
+			{
+				stop_motion(wheel.drive);
+				stop_motion(wheel.steer);
+			}
+		}
+
+		// request detailed description of failure
+		canopen_query(motor, 'M', 'F', 0);
+
+		motor.state = ST_MOTOR_FAILURE;
 	}
 
 	void handle_PDO2(motor_t& motor, const can_msg_t& msg)
@@ -1243,7 +2845,7 @@ private:
 			const auto prev_status = motor.curr_status;
 			motor.curr_status = read_int32(msg, 4);
 			evaluate_status(motor, prev_status);
-			motor.status_recv_time = ros::Time::now();
+			motor.status_recv_time = msg.time;
 		}
 		if(msg.data[0] == 'M' && msg.data[1] == 'F')
 		{
@@ -1257,7 +2859,7 @@ private:
 			{
 				if(motor.homing_state == 0)
 				{
-					if((ros::Time::now() - motor.homing_start_time).toSec() > 0.5)
+					if(to_seconds(msg.time - motor.homing_start_time) > 0.5)
 					{
 						motor.homing_state = 1;		// only go to finish after active for some time
 					}
@@ -1276,7 +2878,14 @@ private:
 		}
 		if(msg.data[0] == 'I' && msg.data[1] == 'Q')
 		{
-			motor.curr_torque = read_float(msg, 4) * motor.torque_constant;
+			const double torque = read_float(msg, 4) * motor.torque_constant;
+			motor.rx.modify([torque](motor_rx_t& rx) {
+				rx.curr_torque = torque;
+			});
+		}
+		if(msg.data[0] == 'U' && msg.data[1] == 'I' && msg.data[2] == 1)
+		{
+			motor.homing_token = read_int32(msg, 4);
 		}
 	}
 
@@ -1341,6 +2950,69 @@ private:
 		}
 	}
 
+	/*
+	 * Returns true if an EMCY msg reports an actual fault, false for warnings which do not stop the drive.
+	 * CAN communication warnings are never faults, otherwise any error register bit besides communication is.
+	 * A fault which disables the drive without setting the error register is still detected via the status word.
+	 */
+	static bool is_emcy_fault(uint16_t code, uint8_t error_register)
+	{
+		if(code == 0x8110 || code == 0x8120 || code == 0x8140) {
+			return false;		// CAN overrun, error passive, recovered from bus-off
+		}
+		return (error_register & ~0x10) != 0;
+	}
+
+	static std::string get_emcy_text(uint16_t code)
+	{
+		std::string text;
+
+		if(code == 0x8130) {
+			text = "heartbeat (PC) lost";
+		}
+		else if(code == 0x8611) {
+			text = "following error";
+		}
+		else if(code == 0x8110 || code == 0x8120 || code == 0x8140) {
+			text = "CAN communication error";
+		}
+		else if((code & 0xF000) == 0x2000) {
+			text = "current";
+		}
+		else if((code & 0xFF00) == 0x3100) {
+			text = "mains voltage";
+		}
+		else if((code & 0xF000) == 0x3000) {
+			text = "voltage";
+		}
+		else if((code & 0xF000) == 0x4000) {
+			text = "temperature";
+		}
+		else if((code & 0xF000) == 0x5000) {
+			text = "device hardware";
+		}
+		else if((code & 0xF000) == 0x6000) {
+			text = "device software";
+		}
+		else if((code & 0xFF00) == 0x7300) {
+			text = "sensor (feedback)";
+		}
+		else if((code & 0xF000) == 0x8000) {
+			text = "monitoring";
+		}
+		else {
+			text = "generic";
+		}
+		return text;
+	}
+
+	void evaluate_emergency(const motor_t& motor) const
+	{
+		const uint16_t code = motor.curr_emcy_code;
+		ROS_ERROR_STREAM(motor.joint_name << ": emergency: " << get_emcy_text(code) << " error (code 0x" << std::hex << code
+				<< ", register 0x" << int(motor.rx.load().curr_error_register) << std::dec << ")");
+	}
+
 	void evaluate_motor_failure(motor_t& motor, int32_t prev_status)
 	{
 		if(motor.curr_motor_failure != prev_status)
@@ -1369,135 +3041,369 @@ private:
 		}
 	}
 
-	void receive_loop()
+	void receive_loop(can_bus_t& bus)
 	{
 		bool is_error = false;
+		int backoff_ms = 0;
 
 		while(do_run && ros::ok())
 		{
-			if(is_error || m_can_sock < 0)
+			if(is_error || bus.sock < 0)
 			{
-				std::lock_guard<std::mutex> lock(m_can_mutex);
-
-				if(m_can_sock >= 0) {
-					::close(m_can_sock);	// close first
-				}
-				if(is_error) {
-					::usleep(1000 * 1000);	// in case of error sleep some time
+				if(is_error)
+				{
+					if(!bus.is_recovering) {
+						bus.is_recovering = true;			// queue messages from now on, instead of waiting
+						bus.error_time = std::chrono::steady_clock::now();
+						backoff_ms = m_can_retry_min_ms;
+					}
+					::usleep(backoff_ms * 1000);			// in case of error sleep some time
+					backoff_ms = std::min(2 * backoff_ms, m_can_retry_max_ms);
 					if(!do_run) {
 						break;
 					}
 				}
+				std::lock_guard<std::mutex> lock(bus.mutex);
+
+				if(bus.sock >= 0) {
+					::close(bus.sock);	// close first
+					bus.sock = -1;
+				}
+				int can_sock = -1;
 				try {
 					// open socket
-					m_can_sock = ::socket(PF_CAN, SOCK_RAW, CAN_RAW);
-					if(m_can_sock < 0) {
+					can_sock = ::socket(PF_CAN, SOCK_RAW, CAN_RAW);
+					if(can_sock < 0) {
 						throw std::runtime_error("socket() failed!");
 					}
 					// set can interface
 					::ifreq ifr = {};
-					::strncpy(ifr.ifr_name, m_can_iface.c_str(), IFNAMSIZ);
-					if(::ioctl(m_can_sock, SIOCGIFINDEX, &ifr) < 0) {
+					::strncpy(ifr.ifr_name, bus.iface.c_str(), IFNAMSIZ);
+					if(::ioctl(can_sock, SIOCGIFINDEX, &ifr) < 0) {
 						throw std::runtime_error("ioctl() failed!");
 					}
+					// receive error frames for bus-off, controller problems and restarts
+					const ::can_err_mask_t err_mask = CAN_ERR_TX_TIMEOUT | CAN_ERR_CRTL | CAN_ERR_BUSOFF | CAN_ERR_RESTARTED;
+					if(::setsockopt(can_sock, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &err_mask, sizeof(err_mask)) < 0) {
+						throw std::runtime_error("setsockopt() failed!");
+					}
+					// get kernel receive time stamps, to measure latency
+					const int enable_stamps = 1;
+					if(::setsockopt(can_sock, SOL_SOCKET, SO_TIMESTAMP, &enable_stamps, sizeof(enable_stamps)) < 0) {
+						throw std::runtime_error("setsockopt() failed!");
+					}
 					// bind to interface
 					::sockaddr_can addr = {};
 					addr.can_family = AF_CAN;
 					addr.can_ifindex = ifr.ifr_ifindex;
-					if(::bind(m_can_sock, (::sockaddr*)(&addr), sizeof(addr)) < 0) {
+					if(::bind(can_sock, (::sockaddr*)(&addr), sizeof(addr)) < 0) {
 						throw std::runtime_error("bind() failed!");
 					}
-					ROS_INFO_STREAM("CAN interface '" << m_can_iface << "' opened successfully.");
+					if(m_can_fd)
+					{
+						// check if interface supports CAN FD
+						if(::ioctl(can_sock, SIOCGIFMTU, &ifr) < 0 || ifr.ifr_mtu != CANFD_MTU) {
+							throw std::runtime_error("interface does not support CAN FD (mtu != 72)");
+						}
+						const int enable = 1;
+						if(::setsockopt(can_sock, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) < 0) {
+							throw std::runtime_error("setsockopt() failed!");
+						}
+					}
+					ROS_INFO_STREAM("CAN interface '" << bus.iface << "' opened successfully.");
 				}
 				catch(const std::exception& ex)
 				{
-					ROS_WARN_STREAM("Failed to open CAN interface '" << m_can_iface << "': "
-							<< ex.what() << " (" << ::strerror(errno) << ")");
+					if(!is_error || backoff_ms >= m_can_retry_max_ms) {
+						ROS_WARN_STREAM("Failed to open CAN interface '" << bus.iface << "': "
+								<< ex.what() << " (" << ::strerror(errno) << ")");
+					}
+					if(can_sock >= 0) {
+						::close(can_sock);
+					}
 					is_error = true;
 					continue;
 				}
+				{
+					std::lock_guard<std::mutex> lock(bus.tx_mutex);
+
+					// setpoints queued while recovering are stale, but commands are replayed in order
+					const size_t num_stale = bus.tx_queue.clear(tx_queue_t::PRIO_PERIODIC);
+					if(num_stale > 0) {
+						ROS_INFO_STREAM("Dropped " << num_stale << " stale CAN setpoints for '" << bus.iface << "'.");
+					}
+					bus.sock = can_sock;
+
+					if(!bus.tx_queue.empty()) {
+						ROS_INFO_STREAM("Replaying " << bus.tx_queue.size() << " queued CAN messages for '" << bus.iface << "'.");
+						can_flush_queue(bus, std::chrono::steady_clock::now());
+					}
+				}
 				is_error = false;
-				m_can_condition.notify_all();	// notify that socket is ready
+				bus.condition.notify_all();	// notify that socket is ready
+			}
+
+			// read a frame, with kernel receive time
+			::canfd_frame frame = {};		// can_frame has the same layout
+			::iovec iov = {&frame, sizeof(frame)};
+			char ctrl[CMSG_SPACE(sizeof(::timeval))] = {};
+			::msghdr hdr = {};
+			hdr.msg_iov = &iov;
+			hdr.msg_iovlen = 1;
+			hdr.msg_control = ctrl;
+			hdr.msg_controllen = sizeof(ctrl);
+
+			const auto res = ::recvmsg(bus.sock, &hdr, 0);
+			if(res != CAN_MTU && res != CANFD_MTU) {
+				if(do_run && !bus.is_recovering) {
+					ROS_WARN_STREAM("recvmsg() failed with " << ::strerror(errno));
+				}
+				is_error = true;
+				continue;
 			}
+			const steady_time_t recv_time = get_steady_time();	// one snapshot per frame, used by all handlers
 
-			// read a frame
-			::can_frame frame = {};
-			const auto res = ::read(m_can_sock, &frame, sizeof(frame));
-			if(res != sizeof(frame)) {
-				if(do_run) {
-					ROS_WARN_STREAM("read() failed with " << ::strerror(errno));
+			::timeval kernel_time = {};
+			for(::cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+				if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMP) {
+					::memcpy(&kernel_time, CMSG_DATA(cmsg), sizeof(kernel_time));
 				}
-				is_error = true;
+			}
+
+			// check for error frames
+			if(frame.can_id & CAN_ERR_FLAG)
+			{
+				handle_error_frame(bus, frame);
 				continue;
 			}
 
+			// we are receiving again
+			if(bus.is_recovering)
+			{
+				const auto delta = recv_time - bus.error_time;
+				ROS_WARN_STREAM("CAN bus '" << bus.iface << "' recovered after "
+						<< std::chrono::duration_cast<std::chrono::milliseconds>(delta).count() << " ms");
+				bus.is_recovering = false;
+				m_is_can_reattached = true;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(bus.rx_load_mutex);
+				bus.rx_load.add(frame.can_id & CAN_SFF_MASK, frame.len, frame.data, frame.flags & CANFD_BRS);
+			}
+
 			// convert frame
 			can_msg_t msg;
+			msg.bus = bus.index;
 			msg.id = frame.can_id & 0x1FFFFFFF;
-			msg.length = frame.can_dlc;
-			for(int i = 0; i < frame.can_dlc; ++i) {
+			msg.time = recv_time;
+			msg.length = std::min<int>(frame.len, sizeof(msg.data));
+			for(int i = 0; i < msg.length; ++i) {
 				msg.data[i] = frame.data[i];
 			}
 
-			// process it
+			// measured values are processed without locking m_node_mutex
+			bool is_event = true;
+			if(motor_t* motor = find_PDO1_motor(msg))
 			{
-				std::lock_guard<std::mutex> lock(m_node_mutex);
+				is_event = handle_PDO1(*motor, msg);		// status word changes need handle() as well
+				check_update_done(bus, msg.time);
+			}
+			if(is_event) {
+				process_event(bus, msg);
+			}
 
-				m_wait_for_can_sock = false;		// disable waiting for transmit (avoid dead-lock)
-				try {
-					handle(msg);
-				}
-				catch(const std::exception& ex) {
-					ROS_WARN_STREAM(ex.what());
+			// keep track of worst case latency
+			if(kernel_time.tv_sec > 0)
+			{
+				::timespec time = {};
+				::clock_gettime(CLOCK_REALTIME, &time);
+				const int64_t latency_us = (int64_t(time.tv_sec) - kernel_time.tv_sec) * 1000000
+											+ time.tv_nsec / 1000 - kernel_time.tv_usec;
+				if(latency_us > bus.max_latency_us) {
+					bus.max_latency_us = latency_us;
 				}
-				m_wait_for_can_sock = true;			// enable waiting again
 			}
 		}
 
 		// close socket
 		{
-			std::lock_guard<std::mutex> lock(m_can_mutex);
-			if(m_can_sock >= 0) {
-				::close(m_can_sock);
-				m_can_sock = -1;
+			std::lock_guard<std::mutex> lock(bus.mutex);
+			if(bus.sock >= 0) {
+				::close(bus.sock);
+				bus.sock = -1;
 			}
 			do_run = false;							// tell node that we are done
-			m_can_condition.notify_all();			// notify that socket is closed
+			bus.condition.notify_all();			// notify that socket is closed
+		}
+	}
+
+	void handle_error_frame(can_bus_t& bus, const ::canfd_frame& frame)
+	{
+		if(frame.can_id & CAN_ERR_BUSOFF)
+		{
+			ROS_ERROR_STREAM("CAN bus-off on '" << bus.iface << "', restarting controller ...");
+			if(!bus.is_recovering) {
+				bus.is_recovering = true;
+				bus.error_time = std::chrono::steady_clock::now();
+			}
+			if(!can_restart_iface(bus.iface)) {
+				ROS_WARN_STREAM_ONCE("Failed to restart CAN controller (" << ::strerror(errno)
+						<< "), need 'restart-ms' to be configured for '" << bus.iface << "'.");
+			}
+		}
+		if(frame.can_id & CAN_ERR_RESTARTED)
+		{
+			ROS_INFO_STREAM("CAN controller '" << bus.iface << "' restarted.");
+		}
+		if(frame.can_id & CAN_ERR_TX_TIMEOUT)
+		{
+			ROS_WARN_STREAM_THROTTLE(1, "CAN transmit timeout on '" << bus.iface << "'");
+		}
+		if(frame.can_id & CAN_ERR_CRTL)
+		{
+			if(frame.data[1] & (CAN_ERR_CRTL_RX_OVERFLOW | CAN_ERR_CRTL_TX_OVERFLOW)) {
+				ROS_WARN_STREAM_THROTTLE(1, "CAN controller buffer overflow on '" << bus.iface << "'");
+			}
+			if(frame.data[1] & (CAN_ERR_CRTL_RX_PASSIVE | CAN_ERR_CRTL_TX_PASSIVE)) {
+				ROS_WARN_STREAM_THROTTLE(1, "CAN controller error passive on '" << bus.iface << "'");
+			}
+		}
+	}
+
+	/*
+	 * Restarts a CAN controller after bus-off via netlink, same as "ip link set <iface> type can restart".
+	 * Needs CAP_NET_ADMIN.
+	 */
+	static bool can_restart_iface(const std::string& iface)
+	{
+		const int index = ::if_nametoindex(iface.c_str());
+		if(index == 0) {
+			return false;
+		}
+		struct {
+			::nlmsghdr header;
+			::ifinfomsg info;
+			char attr[128];
+		} req = {};
+
+		req.header.nlmsg_len = NLMSG_LENGTH(sizeof(::ifinfomsg));
+		req.header.nlmsg_type = RTM_NEWLINK;
+		req.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+		req.info.ifi_family = AF_UNSPEC;
+		req.info.ifi_index = index;
+
+		const uint32_t restart = 1;
+		::rtattr* link_info = add_rtattr(req.header, IFLA_LINKINFO, nullptr, 0);
+		add_rtattr(req.header, IFLA_INFO_KIND, "can", 3);
+		::rtattr* info_data = add_rtattr(req.header, IFLA_INFO_DATA, nullptr, 0);
+		add_rtattr(req.header, IFLA_CAN_RESTART, &restart, sizeof(restart));
+		info_data->rta_len = (char*)(&req.header) + req.header.nlmsg_len - (char*)info_data;
+		link_info->rta_len = (char*)(&req.header) + req.header.nlmsg_len - (char*)link_info;
+
+		const int sock = ::socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+		if(sock < 0) {
+			return false;
+		}
+		bool is_ok = false;
+		if(::send(sock, &req, req.header.nlmsg_len, 0) == ssize_t(req.header.nlmsg_len))
+		{
+			// wait for acknowledge
+			char buf[1024];
+			const auto res = ::recv(sock, buf, sizeof(buf), 0);
+			const ::nlmsghdr* reply = (const ::nlmsghdr*)buf;
+			if(res >= ssize_t(NLMSG_LENGTH(sizeof(::nlmsgerr))) && reply->nlmsg_type == NLMSG_ERROR)
+			{
+				const ::nlmsgerr* error = (const ::nlmsgerr*)NLMSG_DATA(reply);
+				errno = -error->error;
+				is_ok = error->error == 0;
+			}
 		}
+		::close(sock);
+		return is_ok;
+	}
+
+	/*
+	 * Appends a netlink attribute, nested attributes need their length to be fixed afterwards.
+	 */
+	static ::rtattr* add_rtattr(::nlmsghdr& header, int type, const void* data, int length)
+	{
+		::rtattr* attr = (::rtattr*)((char*)(&header) + NLMSG_ALIGN(header.nlmsg_len));
+		attr->rta_type = type;
+		attr->rta_len = RTA_LENGTH(length);
+		if(length > 0) {
+			::memcpy(RTA_DATA(attr), data, length);
+		}
+		header.nlmsg_len = NLMSG_ALIGN(header.nlmsg_len) + RTA_ALIGN(attr->rta_len);
+		return attr;
 	}
 
 private:
 	std::mutex m_node_mutex;
+	std::mutex m_update_mutex;
+	std::condition_variable m_update_condition;		// notified when all motor updates for last SYNC are received
 
 	ros::NodeHandle m_node_handle;
 
 	ros::Publisher m_pub_joint_state;
 	ros::Publisher m_pub_joint_state_raw;
+	ros::Publisher m_pub_diagnostics;
+	ros::Publisher m_pub_cmd_latency;
+
+	std::atomic<uint32_t> m_num_sub_joint_state {0};		// cached number of subscribers
+	std::atomic<uint32_t> m_num_sub_joint_state_raw {0};
+
+	std::thread m_publish_thread;
+	::sem_t m_publish_sem;											// counts samples pushed to can_bus_t::joint_queue
+	std::thread m_mailbox_thread;
+	::sem_t m_mailbox_sem;											// posted for every msg pushed to can_bus_t::rx_mailbox
 
 	ros::Subscriber m_sub_joint_trajectory;
 	ros::Subscriber m_sub_emergency_stop;
 	ros::Subscriber m_sub_joy;
 
+	std::unique_ptr<dynamic_reconfigure::Server<neo_kinematics_omnidrive::SocketCanConfig>> m_reconfigure_server;
+	std::shared_ptr<const control_params_t> m_params;		// read-copy-update, only access via std::atomic_load() / std::atomic_store()
+
 	int m_num_wheels = 0;
 	std::vector<module_t> m_wheels;
 
 	std::string m_can_iface;
 	int m_motor_group_id = -1;
+	int m_drive_group_id = -1;
+	int m_steer_group_id = -1;
+	int m_group_id_object = 0;
 	int m_request_status_divider = 0;
 	int m_heartbeat_divider = 0;
 	double m_control_rate = 0;
 	double m_motor_timeout = 0;
+	int m_motor_heartbeat_ms = 0;
+	int m_can_tx_queue_size = 0;
+	int m_can_retry_min_ms = 0;
+	int m_can_retry_max_ms = 0;
+	int m_can_bitrate = 0;
+	int m_can_data_bitrate = 0;				// CAN FD data phase bitrate, used with BRS
+	bool m_can_fd = false;
+	bool m_can_fd_brs = false;
+	bool m_shared_setpoints = false;
+	int m_shared_rpdo_id = 0;
+	std::vector<int> m_tpdo1_mapping;
+	bool m_has_pdo_current = false;
 	double m_home_vel = 0;
-	double m_steer_gain = 0;
-	double m_steer_lookahead = 0;
-	double m_steer_low_pass = 0;
-	double m_max_steer_vel = 0;
-	double m_drive_low_pass = 0;
+	bool m_phase_aligned_control = false;
+	double m_pdo_timeout = 0;
 	double m_motor_delay = 0;
-	double m_trajectory_timeout = 0;
 	bool m_auto_home = false;
 	bool m_measure_torque = false;
+	bool m_travel_odometry = false;
+	bool m_rpdo_setpoints = false;
+	bool m_set_mode_of_operation = false;	// write 0x6060 = 3 in addition to UM=2 (needs hardware verification)
+	double m_idle_delay = 0;
+	double m_idle_rate = 0;
 	int m_homeing_button = -1;
+	std::string m_homing_state_file;
+	bool m_degraded_mode = false;
+	int m_degraded_min_wheels = 0;
 
 	volatile bool do_run = true;
 	bool is_homing_active = false;
@@ -1507,17 +3413,32 @@ private:
 	bool is_motor_reset = true;
 	bool is_trajectory_timeout = false;
 	bool is_stopped = true;
+	bool is_idle = false;
+	bool is_initialized = false;
+	uint64_t m_boot_counter = 0;
+	uint64_t m_init_boot_counter = 0;
 
 	uint64_t m_sync_counter = 0;
-	ros::Time m_last_sync_time;
-	ros::Time m_last_update_time;
-	ros::Time m_last_trajectory_time;
-
-	std::thread m_can_thread;
-	std::mutex m_can_mutex;
-	std::condition_variable m_can_condition;
-	int m_can_sock = -1;
-	bool m_wait_for_can_sock = true;
+	std::atomic<steady_time_t> m_last_sync_time {steady_time_t()};
+	std::atomic<steady_time_t> m_last_update_time {steady_time_t()};
+	std::atomic<int64_t> m_last_sync_stamp_ns {0};			// ROS time of last SYNC
+	std::atomic<uint32_t> m_enabled_mask {0};				// module_t::is_enabled for receive_loop()
+	steady_time_t m_last_trajectory_time;			// time of last trajectory message
+	ros::Time m_trajectory_stamp;					// header stamp of last trajectory message
+	bool is_new_trajectory = false;					// latency not measured yet
+	steady_time_t m_last_active_time;
+	steady_time_t m_idle_start_time;
+	SteadyClockMap m_clock_map;					// to convert steady time to ROS time
+	WheelTrajectory m_trajectory;					// buffered joint_trajectory input, times in steady seconds
+	std::vector<double> m_traj_wheel_vel;			// sample_trajectory() output
+	std::vector<double> m_traj_steer_pos;			// sample_trajectory() output
+	uint64_t m_idle_start_sync_counter = 0;
+	steady_time_t m_last_load_time;
+	uint64_t m_last_load_sync_counter = 0;
+
+	std::vector<std::unique_ptr<can_bus_t>> m_buses;
+	std::atomic<bool> m_wait_for_can_sock {true};
+	std::atomic<bool> m_is_can_reattached {false};		// set by receive_loop() after recovery
 
 };
 
@@ -1556,9 +3477,19 @@ int main(int argc, char** argv)
 
 	while(ros::ok())
 	{
-		ros::spinOnce();
+		const bool is_idle = node.is_idle_mode();
+
+		if(is_idle) {
+			// sleep until next idle cycle, but wake up immediately on new input
+			ros::getGlobalCallbackQueue()->callAvailable(ros::WallDuration(node.get_idle_period()));
+		} else {
+			ros::spinOnce();
+		}
 
 		try {
+			if(node.is_reinit_required()) {
+				node.initialize();
+			}
 			node.update();
 		}
 		catch(std::exception& ex)
@@ -1568,7 +3499,9 @@ int main(int argc, char** argv)
 			}
 		}
 
-		rate.sleep();
+		if(!is_idle) {
+			rate.sleep();
+		}
 	}
 
 	node.shutdown();
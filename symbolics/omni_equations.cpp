@@ -63,6 +63,17 @@ std::array<ex, 2> calc_move_vel_at_pos(ex wheel_pos_radius, ex wheel_pos_angle,
 	return {vel_x, vel_y};
 }
 
+/*
+ * Computes velocity of the wheel center relative to the steering axis, due to steering rotation.
+ * Note: lever_arm points to y axis, see OmniWheel.h
+ */
+std::array<ex, 2> calc_lever_arm_vel(ex lever_arm, ex wheel_angle, ex steer_vel)
+{
+	ex vel_x = lever_arm * steer_vel * -cos(wheel_angle);			// derivative of lever_arm * -sin(wheel_angle)
+	ex vel_y = lever_arm * steer_vel * -sin(wheel_angle);			// derivative of lever_arm * cos(wheel_angle)
+	return {vel_x, vel_y};
+}
+
 
 int main ()
 {
@@ -74,11 +85,16 @@ int main ()
 	symbol wheel_pos_angle("wheel_pos_angle");
 	symbol wheel_angle("wheel_angle");
 	symbol wheel_vel("wheel_vel");
+	symbol steer_vel("steer_vel");
+	symbol lever_arm("lever_arm");
 
 	auto move_vel_wheel = calc_move_vel_at_pos(	wheel_pos_radius, wheel_pos_angle,
 												move_vel_x, move_vel_y, move_yawrate);
 
-	auto residual = wheel_friction_eq(wheel_angle, wheel_vel, move_vel_wheel[0], move_vel_wheel[1]);
+	auto lever_arm_vel = calc_lever_arm_vel(lever_arm, wheel_angle, steer_vel);
+
+	auto residual = wheel_friction_eq(	wheel_angle, wheel_vel,
+										move_vel_wheel[0] + lever_arm_vel[0], move_vel_wheel[1] + lever_arm_vel[1]);
 
 	std::cout << csrc << "Rx = " << residual[0] << std::endl << std::endl;
 	std::cout << csrc << "Ry = " << residual[1] << std::endl << std::endl;
@@ -0,0 +1,80 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "../include/CanBusLoad.h"
+
+#include <iostream>
+
+void print_frame(uint32_t id, int length, const uint8_t* data)
+{
+	std::cout << CanBusLoad::get_class_name(CanBusLoad::get_class(id, length, data))
+			<< ": " << CanBusLoad::get_frame_bits(id, length, data) << " bits" << std::endl;
+}
+
+
+int main()
+{
+	const uint8_t zero[64] = {};
+	const uint8_t ones[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+	const uint8_t jv[8] = {'J', 'V', 0, 0, 0x10, 0x27, 0, 0};
+	const uint8_t sr[4] = {'S', 'R', 0, 0};
+
+	std::cout << "Test 0: (single frames)" << std::endl;
+	print_frame(0x80, 0, zero);
+	print_frame(0x700, 5, zero);
+	print_frame(0x181, 8, zero);
+	print_frame(0x181, 8, ones);
+	print_frame(0x301, 8, jv);
+	print_frame(0x301, 4, sr);
+	print_frame(0x200, 32, zero);		// CAN FD
+	std::cout << "CAN FD with BRS (1:5): " << CanBusLoad::get_frame_bits(0x200, 32, zero, 0.2) << " bits" << std::endl;
+	print_frame(0x100, 6, zero);		// TIME
+	print_frame(0x781, 8, zero);		// unknown class
+	std::cout << std::endl;
+
+	std::cout << "Test 1: (accounting)" << std::endl;
+	CanBusLoad load;
+	for(int i = 0; i < 4; ++i) {
+		load.add(0x301 + i, 8, jv);
+		load.add(0x181 + i, 8, zero);
+	}
+	load.add(0x80, 0, zero);
+	load.add(0x302, 4, sr);
+	for(const auto& entry : load.get_classes()) {
+		std::cout << CanBusLoad::get_class_name(entry.first) << ": " << entry.second.num_frames
+				<< " frames, " << entry.second.num_bits << " bits" << std::endl;
+	}
+	std::cout << "total: " << load.get_total().num_frames << " frames, " << load.get_total().num_bits << " bits" << std::endl;
+	std::cout << std::endl;
+}
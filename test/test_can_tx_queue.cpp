@@ -0,0 +1,103 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "../include/CanTxQueue.h"
+
+#include <iostream>
+
+typedef CanTxQueue<int> queue_t;
+
+void print_queue(queue_t& queue)
+{
+	std::cout << "size=" << queue.size() << ", dropped=" << queue.get_num_dropped()
+			<< ", coalesced=" << queue.get_num_coalesced() << ":";
+	while(!queue.empty()) {
+		std::cout << " " << queue.front();
+		queue.pop();
+	}
+	std::cout << std::endl;
+}
+
+
+int main()
+{
+	queue_t queue(5);
+
+	std::cout << "Test 0: (priority order)" << std::endl;
+	queue.push(1, queue_t::PRIO_COMMAND);
+	queue.push(2, queue_t::PRIO_PERIODIC);
+	queue.push(3, queue_t::PRIO_COMMAND);
+	queue.push(4, queue_t::PRIO_PERIODIC);
+	queue.push(5, queue_t::PRIO_COMMAND);
+	print_queue(queue);
+	std::cout << std::endl;
+
+	std::cout << "Test 1: (coalescing)" << std::endl;
+	queue.push(10, queue_t::PRIO_PERIODIC, 1);
+	queue.push(20, queue_t::PRIO_PERIODIC, 2);
+	queue.push(11, queue_t::PRIO_PERIODIC, 1);
+	queue.push(12, queue_t::PRIO_COMMAND, 1);		// commands are never coalesced
+	queue.push(13, queue_t::PRIO_COMMAND, 1);
+	print_queue(queue);
+	std::cout << std::endl;
+
+	std::cout << "Test 2: (overflow)" << std::endl;
+	queue.push(0, queue_t::PRIO_PERIODIC);
+	for(int i = 1; i < 5; ++i) {
+		queue.push(i, queue_t::PRIO_COMMAND);
+	}
+	queue.push(10, queue_t::PRIO_COMMAND);		// drops 0
+	queue.push(11, queue_t::PRIO_COMMAND);		// dropped
+	queue.push(12, queue_t::PRIO_PERIODIC);		// dropped
+	print_queue(queue);
+	std::cout << std::endl;
+
+	std::cout << "Test 3: (homing sequence under backpressure: config -> arm -> BG stays in order)" << std::endl;
+	queue.push(100, queue_t::PRIO_COMMAND);			// HM[2] config
+	queue.push(200, queue_t::PRIO_PERIODIC, 1);		// JV setpoint
+	queue.push(101, queue_t::PRIO_COMMAND);			// HM[3] config
+	queue.push(102, queue_t::PRIO_COMMAND);			// HM[1] arm
+	queue.push(201, queue_t::PRIO_PERIODIC, 1);		// JV setpoint (coalesced)
+	queue.push(103, queue_t::PRIO_COMMAND);			// BG
+	print_queue(queue);
+	std::cout << std::endl;
+
+	std::cout << "Test 4: (drop periodic after recovery, keep commands)" << std::endl;
+	queue.push(1, queue_t::PRIO_COMMAND);
+	queue.push(2, queue_t::PRIO_PERIODIC, 1);
+	queue.push(3, queue_t::PRIO_COMMAND);
+	std::cout << "removed " << queue.clear(queue_t::PRIO_PERIODIC) << std::endl;
+	print_queue(queue);
+	std::cout << std::endl;
+}
@@ -112,6 +112,37 @@ int main()
 		print_wheels(result);
 		std::cout << std::endl;
 	}
+	{
+		OmniKinematics limited(4);
+		for(int i = 0; i < 4; ++i) {
+			limited.max_wheel_vel[i] = 0.5;
+		}
+
+		auto result = limited.compute(wheels, 0.5, 0, 1);
+		std::cout << "Test 6: (vel_scale = " << limited.vel_scale << ")" << std::endl;
+		print_wheels(result);
+		std::cout << std::endl;
+	}
+	{
+		OmniKinematics limited(4);
+		for(int i = 0; i < 4; ++i) {
+			limited.max_steer_vel[i] = 5;
+		}
+
+		auto result = limited.compute(wheels, 0, 1, 0);
+		std::cout << "Test 7: (vel_scale = " << limited.vel_scale << ")" << std::endl;
+		print_wheels(result);
+		std::cout << std::endl;
+	}
+	{
+		OmniKinematics degraded(4);
+		degraded.is_enabled[2] = false;
+
+		auto result = degraded.compute(wheels, 1, 0, 0);
+		std::cout << "Test 8:" << std::endl;
+		print_wheels(result);
+		std::cout << std::endl;
+	}
 
 }
 
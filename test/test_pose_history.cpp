@@ -0,0 +1,85 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "../include/PoseHistory.h"
+
+#include <iostream>
+
+void print_sample(const PoseHistory& history, double time)
+{
+	PoseHistory::sample_t sample;
+	if(history.get_sample(time, sample)) {
+		std::cout << "time=" << time << ": x=" << sample.x << ", y=" << sample.y << ", yaw=" << sample.yaw
+				<< ", vel_x=" << sample.vel_x << ", yawrate=" << sample.yawrate << std::endl;
+	} else {
+		std::cout << "time=" << time << ": not available" << std::endl;
+	}
+}
+
+
+int main()
+{
+	PoseHistory history(10);
+
+	for(int i = 0; i < 15; ++i)
+	{
+		PoseHistory::sample_t sample;
+		sample.time = i * 0.1;
+		sample.x = i;
+		sample.yaw = angles::normalize_angle(i * 0.5);
+		sample.vel_x = 10;
+		sample.yawrate = 5;
+		history.add(sample);
+	}
+
+	std::cout << "Test 0: (size = " << history.size() << ")" << std::endl;
+	print_sample(history, 0.3);
+	print_sample(history, 0.5);
+	print_sample(history, 0.55);
+	print_sample(history, 0.75);
+	print_sample(history, 1.4);
+	print_sample(history, 1.5);
+	std::cout << std::endl;
+
+	// time jump back
+	{
+		PoseHistory::sample_t sample;
+		sample.time = 0.1;
+		history.add(sample);
+	}
+	std::cout << "Test 1: (size = " << history.size() << ")" << std::endl;
+	print_sample(history, 0.1);
+	print_sample(history, 0.55);
+	std::cout << std::endl;
+}
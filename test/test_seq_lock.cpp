@@ -0,0 +1,96 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "../include/SeqLock.h"
+
+#include <iostream>
+#include <thread>
+
+struct sample_t
+{
+	int64_t a = 0;
+	int64_t b = 0;
+	double c = 0;
+};
+
+
+int main()
+{
+	std::cout << "Test 0: (load / store / modify)" << std::endl;
+	{
+		SeqLock<sample_t> lock;
+		sample_t sample;
+		sample.a = 1;
+		sample.b = 2;
+		sample.c = 3.5;
+		lock.store(sample);
+		lock.modify([](sample_t& data) { data.b += 10; });
+		const sample_t out = lock.load();
+		std::cout << out.a << " " << out.b << " " << out.c << std::endl;
+
+		SeqLock<sample_t> copy(lock);
+		std::cout << copy.load().b << std::endl;
+	}
+	std::cout << std::endl;
+
+	std::cout << "Test 1: (concurrent writers and reader)" << std::endl;
+	{
+		const int count = 200000;
+		SeqLock<sample_t> lock;
+
+		auto writer = [&lock, count]() {
+			for(int i = 0; i < count; ++i) {
+				lock.modify([](sample_t& data) {
+					data.a++;
+					data.b = -data.a;
+					data.c = data.a * 0.5;
+				});
+			}
+		};
+		std::thread writer_0(writer);
+		std::thread writer_1(writer);
+
+		int num_torn = 0;
+		for(int i = 0; i < count; ++i) {
+			const sample_t out = lock.load();
+			if(out.b != -out.a || out.c != out.a * 0.5) {
+				num_torn++;
+			}
+		}
+		writer_0.join();
+		writer_1.join();
+		std::cout << "final=" << lock.load().a << ", torn=" << num_torn << std::endl;
+	}
+	std::cout << std::endl;
+}
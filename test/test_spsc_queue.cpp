@@ -0,0 +1,100 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "../include/SpscQueue.h"
+
+#include <iostream>
+#include <thread>
+
+
+int main()
+{
+	std::cout << "Test 0: (fill and drop)" << std::endl;
+	{
+		SpscQueue<int> queue(3);
+		for(int i = 0; i < 5; ++i) {
+			std::cout << queue.push(i) << " ";
+		}
+		std::cout << "size=" << queue.size() << ", dropped=" << queue.get_num_dropped() << ":";
+		int value = 0;
+		while(queue.pop(value)) {
+			std::cout << " " << value;
+		}
+		std::cout << std::endl;
+	}
+	std::cout << std::endl;
+
+	std::cout << "Test 1: (wrap around)" << std::endl;
+	{
+		SpscQueue<int> queue(2);
+		int value = 0;
+		for(int i = 0; i < 5; ++i) {
+			queue.push(i);
+			queue.pop(value);
+			std::cout << value << " ";
+		}
+		std::cout << "empty=" << queue.empty() << std::endl;
+	}
+	std::cout << std::endl;
+
+	std::cout << "Test 2: (two threads)" << std::endl;
+	{
+		const int count = 1000000;
+		SpscQueue<std::vector<int>> queue(16, std::vector<int>(4));
+
+		std::thread producer([&queue, count]() {
+			std::vector<int> sample(4);
+			for(int i = 0; i < count; ++i) {
+				sample[0] = i;
+				while(!queue.push(sample)) {
+					std::this_thread::yield();
+				}
+			}
+		});
+
+		int num_errors = 0;
+		std::vector<int> sample;
+		for(int i = 0; i < count; ++i) {
+			while(!queue.pop(sample)) {
+				std::this_thread::yield();
+			}
+			if(sample.size() != 4 || sample[0] != i) {
+				num_errors++;
+			}
+		}
+		producer.join();
+		std::cout << "errors=" << num_errors << std::endl;
+	}
+	std::cout << std::endl;
+}
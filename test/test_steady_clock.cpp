@@ -0,0 +1,68 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "../include/SteadyClock.h"
+
+#include <iostream>
+
+
+int main()
+{
+	const steady_time_t t0 = get_steady_time();
+
+	std::cout << "Test 0: (to_seconds)" << std::endl;
+	std::cout << to_seconds(std::chrono::milliseconds(1500)) << std::endl;
+	std::cout << to_seconds(std::chrono::microseconds(-250)) << std::endl;
+	std::cout << std::endl;
+
+	std::cout << "Test 1: (conversion)" << std::endl;
+	SteadyClockMap map;
+	map.update(t0, 1000);
+	std::cout << map.convert(t0) << std::endl;
+	std::cout << map.convert(t0 + std::chrono::milliseconds(20)) << std::endl;
+	std::cout << map.convert(t0 - std::chrono::seconds(2)) << std::endl;
+	std::cout << to_seconds(map.to_steady(1000.25) - t0) << std::endl;
+	std::cout << to_seconds(map.to_steady(999) - t0) << std::endl;
+	std::cout << std::endl;
+
+	std::cout << "Test 2: (clock step)" << std::endl;
+	map.update(t0 + std::chrono::seconds(1), 5000);		// other clock jumped ahead
+	std::cout << map.convert(t0 + std::chrono::seconds(1)) << std::endl;
+	std::cout << map.convert(t0 + std::chrono::milliseconds(1010)) << std::endl;
+	std::cout << std::endl;
+
+	std::cout << "Test 3: (monotonic)" << std::endl;
+	std::cout << (get_steady_time() >= t0) << std::endl;
+	std::cout << std::endl;
+}
@@ -117,5 +117,38 @@ int main()
 
 	std::cout << "Test 4: " << solver.move_vel_x << ", " << solver.move_vel_y << ", " << solver.move_yawrate << " (R_norm = " << solver.R_norm  << ")" << std::endl;
 
+	for(auto& wheel : wheels)
+	{
+		wheel.set_wheel_angle(0);
+		wheel.wheel_vel = 1;
+	}
+	wheels[0].set_wheel_angle(1.57);
+	wheels[0].wheel_vel = 1;
+	solver.is_enabled[0] = false;
+
+	solver.move_vel_x = 0;
+	solver.move_vel_y = 0;
+	solver.move_yawrate = 0;
+	solver.solve(wheels);
+
+	std::cout << "Test 5: " << solver.move_vel_x << ", " << solver.move_vel_y << ", " << solver.move_yawrate << " (R_norm = " << solver.R_norm  << ")" << std::endl;
+
+	// steering on the spot, wheels roll due to lever arm only
+	for(auto& wheel : wheels)
+	{
+		wheel.lever_arm = 0.1;
+		wheel.set_wheel_angle(0);
+		wheel.steer_vel = 1;
+		wheel.wheel_vel = -0.1;
+	}
+	solver.is_enabled[0] = true;
+
+	solver.move_vel_x = 0;
+	solver.move_vel_y = 0;
+	solver.move_yawrate = 0;
+	solver.solve(wheels);
+
+	std::cout << "Test 6: " << solver.move_vel_x << ", " << solver.move_vel_y << ", " << solver.move_yawrate << " (R_norm = " << solver.R_norm  << ")" << std::endl;
+
 }
 
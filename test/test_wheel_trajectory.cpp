@@ -0,0 +1,97 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, Neobotix GmbH
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Neobotix nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "../include/WheelTrajectory.h"
+
+#include <iostream>
+
+void print_sample(const WheelTrajectory& trajectory, double time)
+{
+	std::vector<double> wheel_vel(2);
+	std::vector<double> steer_pos(2);
+	if(trajectory.sample(time, wheel_vel, steer_pos)) {
+		std::cout << "time=" << time << ": wheel_vel=[" << wheel_vel[0] << ", " << wheel_vel[1]
+				<< "], steer_pos=[" << steer_pos[0] << ", " << steer_pos[1] << "]" << std::endl;
+	} else {
+		std::cout << "time=" << time << ": not available" << std::endl;
+	}
+}
+
+
+int main()
+{
+	WheelTrajectory trajectory;
+
+	std::cout << "Test 0: (empty)" << std::endl;
+	print_sample(trajectory, 0);
+	std::cout << std::endl;
+
+	std::vector<WheelTrajectory::point_t> points(3);
+	for(int i = 0; i < 3; ++i)
+	{
+		points[i].time = i * 0.1;
+		points[i].wheel_vel = {i * 1.0, -i * 1.0};
+		points[i].steer_pos = {i * 0.5, 3.0 + i * 0.1};		// second wheel crosses +-pi
+	}
+	trajectory.set(points);
+
+	std::cout << "Test 1: (size = " << trajectory.size() << ", end = " << trajectory.get_end_time() << ")" << std::endl;
+	print_sample(trajectory, -0.1);
+	print_sample(trajectory, 0);
+	print_sample(trajectory, 0.05);
+	print_sample(trajectory, 0.15);
+	print_sample(trajectory, 0.2);
+	print_sample(trajectory, 0.5);
+	std::cout << std::endl;
+
+	// single point trajectory
+	points.resize(1);
+	trajectory.set(points);
+	std::cout << "Test 2: (size = " << trajectory.size() << ")" << std::endl;
+	print_sample(trajectory, -1);
+	print_sample(trajectory, 1);
+	std::cout << std::endl;
+
+	// invalid time order
+	points.resize(2);
+	points[1] = points[0];
+	std::cout << "Test 3:" << std::endl;
+	try {
+		trajectory.set(points);
+		std::cout << "no exception!" << std::endl;
+	} catch(const std::exception& ex) {
+		std::cout << "exception: " << ex.what() << std::endl;
+	}
+	std::cout << "size = " << trajectory.size() << std::endl;
+}